@@ -42,6 +42,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include "c_io.h"
 #include "d_event.h"
@@ -56,6 +57,7 @@
 #include "i_swap.h"
 #include "m_menu.h"
 #include "m_misc.h"
+#include "r_prof.h"
 #include "s_sound.h"
 #include "sounds.h"
 #include "v_misc.h"
@@ -133,6 +135,20 @@ extern boolean    redrawsbar;
 extern char       *shiftxform;
 
 
+// commands run from the console command line
+static struct
+{
+    char        *name;
+    void        (*func)(void);
+} commands[] = {
+    { "zonestats",  Z_DumpStats       },
+    { "cachestats", W_PrintCacheStats },
+    { "profile",    R_ProfToggle      },
+    { "profstats",  R_ProfDumpStats   },
+    { NULL,         NULL              }
+};
+
+
 static struct
 {
     char        char1;
@@ -364,6 +380,49 @@ static void C_UpdateInputPoint(void)
 }
 
 
+//
+// run the command typed on the command line
+//
+static void C_RunCommand(char *cmd)
+{
+    int         i;
+
+    if(!*cmd)
+        return;
+
+    C_Printf("%s %s\n", inputprompt, cmd);
+
+    for(i = 0; commands[i].name; i++)
+    {
+        if(!strcasecmp(cmd, commands[i].name))
+        {
+            commands[i].func();
+            return;
+        }
+    }
+
+    C_Printf("unknown command: %s\n", cmd);
+}
+
+//
+// put the next or previous command on the command line
+//
+static void C_SelectCommand(int dir)
+{
+    static int  selected = -1;
+    int         numcommands;
+
+    for(numcommands = 0; commands[numcommands].name; numcommands++);
+
+    if(selected < 0)
+        selected = dir > 0 ? 0 : numcommands - 1;
+    else
+        selected = (selected + dir + numcommands) % numcommands;
+
+    strcpy(inputtext, commands[selected].name);
+    C_UpdateInputPoint();
+}
+
 int C_Responder(event_t* ev)
 {
     static int shiftdown;
@@ -389,13 +448,33 @@ int C_Responder(event_t* ev)
 
             return consoleactive;
         }
-        else if(data->btns_d & WPAD_CLASSIC_BUTTON_LEFT   ||
-                data->btns_d & WPAD_CLASSIC_BUTTON_B      ||
+        // there is no keyboard: left and right pick a command for
+        // the command line, and A runs it
+        else if(data->btns_d & WPAD_CLASSIC_BUTTON_LEFT)
+        {
+            if(consoleactive)
+                C_SelectCommand(-1);
+
+            return consoleactive;
+        }
+        else if(data->btns_d & WPAD_CLASSIC_BUTTON_RIGHT)
+        {
+            if(consoleactive)
+                C_SelectCommand(1);
+
+            return consoleactive;
+        }
+        else if(data->btns_d & WPAD_CLASSIC_BUTTON_A)
+        {
+            if(consoleactive)
+                C_RunCommand(inputtext);
+
+            return consoleactive;
+        }
+        else if(data->btns_d & WPAD_CLASSIC_BUTTON_B      ||
                 data->btns_d & WPAD_CLASSIC_BUTTON_MINUS  ||
                 data->btns_d & WPAD_CLASSIC_BUTTON_HOME   ||
                 data->btns_d & WPAD_CLASSIC_BUTTON_PLUS   ||
-                data->btns_d & WPAD_CLASSIC_BUTTON_A      ||
-                data->btns_d & WPAD_CLASSIC_BUTTON_RIGHT  ||
                 data->btns_d & WPAD_CLASSIC_BUTTON_X      ||
                 data->btns_d & WPAD_CLASSIC_BUTTON_FULL_L ||
                 data->btns_d & WPAD_CLASSIC_BUTTON_Y      ||
@@ -880,6 +959,37 @@ void C_Printf(char *s, ...)
     (free)(t);
 }
 
+//
+// write to f, or to the console if f is NULL
+//
+void C_FPrintf(FILE *f, char *s, ...)
+{
+    va_list args;
+
+    char *t;
+
+    if(!s)
+        return;
+
+    va_start(args, s);
+
+    if(f)
+    {
+        vfprintf(f, s, args);
+        va_end(args);
+        return;
+    }
+
+    vasprintf(&t, s, args);
+    va_end(args);
+
+    C_AdjustLineBreaks(t);
+
+    C_AddMessage(t);
+
+    (free)(t);
+}
+
 //
 // Console activation
 //
@@ -32,6 +32,8 @@
 #define __C_IO_H__
 
 
+#include <stdio.h>
+
 #include "doomstat.h"
 #include "d_event.h"
 #include "v_video.h"
@@ -50,6 +52,7 @@ void C_Drawer(void);
 void C_Update(void);
 void C_Puts(char *s);
 void C_Printf(char *s, ...);
+void C_FPrintf(FILE *f, char *s, ...);
 void C_Seperator(void);
 void C_SetConsole(void);
 void C_Popup(void);
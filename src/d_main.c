@@ -58,6 +58,7 @@
 #include "i_system.h"
 #include "i_timer.h"
 #include "i_video.h"
+#include "m_argv.h"
 #include "m_config.h"
 #include "m_controls.h"
 #include "m_menu.h"
@@ -69,13 +70,16 @@
 #include "p_saveg.h"
 #include "p_setup.h"
 #include "r_local.h"
+#include "r_prof.h"
 #include "s_sound.h"
 #include "sounds.h"
 #include "st_stuff.h"
 #include "sys_wpad.h"
 #include "v_video.h"
 #include "video.h"
+#include "w_index.h"
 #include "w_merge.h"
+#include "w_prefetch.h"
 #include "w_wad.h"
 #include "wi_stuff.h"
 #include "z_zone.h"
@@ -258,7 +262,9 @@ void D_Display (void)
             redrawsbar = true;
         if (inhelpscreensstate && !inhelpscreens)
             redrawsbar = true;              // just put away the help screen
+        R_ProfStart (PROF_HUD);
         ST_Drawer (scaledviewheight == (200 << hires), redrawsbar );     // HIRES
+        R_ProfStop (PROF_HUD);
 
         if(warped == 1)
         {
@@ -296,7 +302,11 @@ void D_Display (void)
         R_RenderPlayerView (&players[displayplayer]);
 
     if (gamestate == GS_LEVEL && gametic)
+    {
+        R_ProfStart (PROF_HUD);
         HU_Drawer ();
+        R_ProfStop (PROF_HUD);
+    }
     
     // clean up border stuff
     if (gamestate != oldgamestate && gamestate != GS_LEVEL)
@@ -341,6 +351,7 @@ void D_Display (void)
     if (!wipe)
     {
         I_FinishUpdate ();              // page flip or blit buffer
+        R_ProfFrame ();
         return;
     }
     
@@ -388,6 +399,8 @@ void D_BindVariables(void)
 
 void D_DoomLoop (void)
 {
+    unsigned int framestart = 0;
+
     if (demorecording)
         G_BeginRecording ();
 
@@ -416,6 +429,9 @@ void D_DoomLoop (void)
 
     while (1)
     {
+        if (timingdemo)
+            framestart = I_GetTimeUS();
+
         // check if the OGG music stopped playing
         if(usergame && gamestate != GS_DEMOSCREEN && gamestate != GS_CONSOLE && !finale_music)
             I_SDL_PollMusic();
@@ -426,12 +442,19 @@ void D_DoomLoop (void)
         // will run at least one tic
         TryRunTics ();
 
+        // -fastdemo runs the play simulation only
+        if (fastdemo)
+            continue;
+
         // move positional sounds
         S_UpdateSounds (players[consoleplayer].mo);
 
         // Update display, next frame, with current state.
         if (screenvisible)
             D_Display ();
+
+        if (timingdemo)
+            G_TimeDemoFrame(framestart, I_GetTimeUS());
     }
 }
 
@@ -842,6 +865,27 @@ static void G_CheckDemoStatusAtExit (void)
     G_CheckDemoStatus();
 }
 
+static void D_DumpZoneStats (void)
+{
+    FILE *f = NULL;
+
+    if(usb)
+        f = fopen("usb:/apps/wiidoom/zonestats.txt","w");
+    else if(sd)
+        f = fopen("sd:/apps/wiidoom/zonestats.txt","w");
+
+    if (f)
+    {
+        Z_FileDumpStats(f);
+        W_WriteCacheStats(f);
+
+        if (display_profile)
+            R_ProfWriteStats(f);
+
+        fclose(f);
+    }
+}
+
 //
 // D_DoomMain
 //
@@ -853,6 +897,8 @@ void D_DoomMain (void)
 {
     FILE *fprw;
 
+    int             p;
+
     char            file[256];
 
     if(devparm || devparm_net)
@@ -1217,6 +1263,9 @@ void D_DoomMain (void)
     // Save configuration at exit.
     I_AtExit(M_SaveDefaults, false);
 
+    // Dump the zone telemetry at exit.
+    I_AtExit(D_DumpZoneStats, true);
+
     printf(" Z_Init: Init zone memory allocation daemon. \n");
     printf(" heap size: 0x3cdb000 \n");
     printf(" W_Init: Init WADfiles.\n");
@@ -1397,6 +1446,17 @@ void D_DoomMain (void)
 
     W_GenerateHashTable();
 
+    //!
+    // Time lump name lookups on a made up directory of 20000 lumps,
+    // and quit.
+    //
+
+    if (M_CheckParm("-lumpbench"))
+    {
+        W_BenchmarkHashTable(20000);
+        exit(0);
+    }
+
     if(fsize == 12361532)
         LoadChexDeh();
 
@@ -1490,6 +1550,15 @@ void D_DoomMain (void)
         }
     }
 
+    // Every WAD, resource PWADs included, has been added and merged:
+    // share cache entries between identical lumps.
+
+    W_ResolveAliases();
+
+    // Keep the WAD directories and merges for the next run.
+
+    W_SaveIndex();
+
     if(gamemode == shareware && gameversion != exe_chex)
     {
         printf("         shareware version.\n");
@@ -1696,6 +1765,17 @@ void D_DoomMain (void)
     C_Printf(" I_StartupTimer\n");
     I_InitTimer();
 
+    //!
+    // Don't load the next level's lumps in the background.
+    //
+
+    if (!M_CheckParm("-noprefetch"))
+    {
+        printf(" W_PrefetchInit: Starting lump prefetch thread.\n");
+        C_Printf(" W_PrefetchInit: Starting lump prefetch thread.\n");
+        W_PrefetchInit();
+    }
+
     printf(" I_StartupSound\n");
     C_Printf(" I_StartupSound\n");
 
@@ -1767,6 +1847,42 @@ void D_DoomMain (void)
     if(nerve_pwad)
         LoadNerveWad();
 
+    //!
+    // @arg <demo>
+    // @category demo
+    // @vanilla
+    //
+    // Play back the demo lump named demo as fast as possible, rendering
+    // every tic, then report the frame times and quit.
+    //
+
+    p = M_CheckParmWithArgs("-timedemo", 1);
+
+    if (p)
+    {
+        singledemo = true;              // quit after one demo
+        G_TimeDemo(myargv[p + 1]);
+        D_DoomLoop();                   // never returns
+    }
+
+    //!
+    // @arg <demo>
+    // @category demo
+    //
+    // Run the demo lump named demo through the play simulation only,
+    // without drawing or sound, then report tics per second and a
+    // hash of the final game state.
+    //
+
+    p = M_CheckParmWithArgs("-fastdemo", 1);
+
+    if (p)
+    {
+        singledemo = true;              // quit after one demo
+        G_FastDemo(myargv[p + 1]);
+        D_DoomLoop();                   // never returns
+    }
+
     if (startloadgame >= 0)
     {
         strcpy(file, P_SaveGameFile(startloadgame));
@@ -206,6 +206,12 @@ extern boolean lowres_turn;
 // Quit after playing a demo from cmdline.
 extern  boolean                singledemo;        
 
+// Exit with a frame time report when the demo ends.
+extern  boolean                timingdemo;
+
+// Run the play simulation only, without rendering or sound.
+extern  boolean                fastdemo;
+
 
 
 
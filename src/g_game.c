@@ -58,6 +58,7 @@
 
 // SKY handling - still the wrong place.
 #include "r_data.h"
+#include "r_prof.h"
 #include "r_sky.h"
 
 #include "s_sound.h"
@@ -194,6 +195,7 @@ boolean         sendpause;              // send a pause event next tic
 boolean         sendsave;               // send a save event next tic 
 boolean         usergame;               // ok to save / end game 
 boolean         timingdemo;             // if true, exit with report on completion  
+boolean         fastdemo;               // if true, run the playsim only
 boolean         viewactive; 
 boolean         deathmatch;             // only if started as net death 
 boolean         netgame;                // only true if packets are broadcast 
@@ -217,6 +219,15 @@ byte*           demoend;
 
 byte            consistancy[MAXPLAYERS][BACKUPTICS]; 
 
+// Frame times recorded while timing a demo, in microseconds.
+
+static unsigned int *timedemo_frames;
+static int      timedemo_numframes;
+static int      timedemo_maxframes;
+static int      timedemo_starttic;
+static int      timedemo_startms;
+static unsigned int timedemo_startus;
+
 static boolean  dclickstate2;
 
 static char     savedescription[32]; 
@@ -241,6 +252,7 @@ extern boolean  aiming_help;
 extern boolean  messageNeedsInput;
 extern boolean  setsizeneeded;
 extern boolean  map_flag;
+extern boolean  usb;
 
 extern fixed_t  forwardmove; 
 extern fixed_t  sidemove; 
@@ -1139,6 +1151,14 @@ void G_DoPlayDemo (void)
     precache = true; 
     starttime = I_GetTime (); 
 
+    if (timingdemo || fastdemo)
+    {
+        timedemo_numframes = 0;
+        timedemo_starttic = gametic;
+        timedemo_startms = I_GetTimeMS();
+        timedemo_startus = I_GetTimeUS();
+    }
+
     usergame = false; 
     demoplayback = true; 
 } 
@@ -1174,6 +1194,10 @@ void G_DoCompleted (void)
     int             i; 
          
     gameaction = ga_nothing; 
+
+    // the last second of the level, to the console
+    if (display_profile)
+        R_ProfDumpStats ();
  
     for (i=0 ; i<MAXPLAYERS ; i++) 
         if (playeringame[i]) 
@@ -2057,6 +2081,161 @@ void G_TimeDemo (char* name)
     defdemoname = name; 
     gameaction = ga_playdemo; 
 } 
+
+//
+// G_FastDemo
+// Like G_TimeDemo, but D_DoomLoop skips drawing and sound entirely,
+// so that only the play simulation is measured.
+//
+void G_FastDemo (char* name)
+{
+    fastdemo = true;
+    singletics = true;
+
+    defdemoname = name;
+    gameaction = ga_playdemo;
+}
+
+//
+// G_TimeDemoFrame
+// Called by D_DoomLoop with the start and end time of every frame
+// while timing a demo.  Frames begun before the demo started (the
+// level load) are not counted.
+//
+void G_TimeDemoFrame (unsigned int start, unsigned int end)
+{
+    if (!demoplayback || (int) (start - timedemo_startus) < 0)
+        return;
+
+    if (timedemo_numframes == timedemo_maxframes)
+    {
+        timedemo_maxframes = timedemo_maxframes ? timedemo_maxframes * 2 : 4096;
+        timedemo_frames = realloc(timedemo_frames,
+                                  timedemo_maxframes * sizeof(*timedemo_frames));
+
+        if (timedemo_frames == NULL)
+            I_Error ("G_TimeDemoFrame: Couldn't realloc frame times");
+    }
+
+    timedemo_frames[timedemo_numframes++] = end - start;
+}
+
+static int CompareFrameTimes (const void *a, const void *b)
+{
+    unsigned int fa = *(const unsigned int *) a;
+    unsigned int fb = *(const unsigned int *) b;
+
+    return fa < fb ? -1 : fa > fb;
+}
+
+//
+// G_TimeDemoReport
+// Prints the results of a timed demo to stdout and the console,
+// and appends them as one row to timedemo.csv.
+//
+static void G_TimeDemoReport (void)
+{
+    int         i;
+    int         gametics;
+    int         realtics;
+    int         wallms;
+    double      total;
+    double      avg, min, max, p99;
+    double      fps;
+    char        *csvname;
+    boolean     newcsv;
+    FILE        *csv;
+
+    gametics = gametic - timedemo_starttic;
+    realtics = I_GetTime() - starttime;
+    wallms = I_GetTimeMS() - timedemo_startms;
+
+    total = avg = min = max = p99 = 0;
+
+    if (timedemo_numframes > 0)
+    {
+        qsort(timedemo_frames, timedemo_numframes,
+              sizeof(*timedemo_frames), CompareFrameTimes);
+
+        for (i = 0; i < timedemo_numframes; i++)
+            total += timedemo_frames[i];
+
+        avg = total / timedemo_numframes / 1000.0;
+        min = timedemo_frames[0] / 1000.0;
+        max = timedemo_frames[timedemo_numframes - 1] / 1000.0;
+        p99 = timedemo_frames[(timedemo_numframes * 99) / 100] / 1000.0;
+    }
+
+    fps = realtics > 0 ? (double) gametics * TICRATE / realtics : 0;
+
+    printf(" timed %i gametics in %i realtics (%i frames, %i ms)\n",
+           gametics, realtics, timedemo_numframes, wallms);
+    printf(" frame ms: avg %.3f min %.3f max %.3f p99 %.3f\n",
+           avg, min, max, p99);
+    printf(" %.2f fps\n", fps);
+
+    C_Printf(" timed %i gametics in %i realtics (%i frames, %i ms)\n",
+             gametics, realtics, timedemo_numframes, wallms);
+    C_Printf(" frame ms: avg %.3f min %.3f max %.3f p99 %.3f\n",
+             avg, min, max, p99);
+    C_Printf(" %.2f fps\n", fps);
+
+    if (usb)
+        csvname = "usb:/apps/wiidoom/timedemo.csv";
+    else
+        csvname = "sd:/apps/wiidoom/timedemo.csv";
+
+    newcsv = !M_FileExists(csvname);
+
+    csv = fopen(csvname, "a");
+
+    if (csv == NULL)
+    {
+        C_Printf(" couldn't open %s\n", csvname);
+        return;
+    }
+
+    if (newcsv)
+        fprintf(csv, "demo,gametics,frames,realtics,wall_ms,"
+                     "avg_ms,min_ms,max_ms,p99_ms,fps\n");
+
+    fprintf(csv, "%s,%i,%i,%i,%i,%.3f,%.3f,%.3f,%.3f,%.2f\n",
+            defdemoname, gametics, timedemo_numframes, realtics, wallms,
+            avg, min, max, p99, fps);
+
+    fclose(csv);
+}
+
+//
+// G_FastDemoReport
+// Prints the play simulation rate of a -fastdemo run and a hash of
+// the final level state.
+//
+static void G_FastDemoReport (void)
+{
+    sha1_digest_t digest;
+    char        hash[sizeof(digest) * 2 + 1];
+    int         gametics;
+    int         wallms;
+    double      tps;
+    int         i;
+
+    gametics = gametic - timedemo_starttic;
+    wallms = I_GetTimeMS() - timedemo_startms;
+
+    tps = wallms > 0 ? gametics * 1000.0 / wallms : 0;
+
+    P_Checksum(digest);
+
+    for (i = 0; i < sizeof(digest); i++)
+        sprintf(hash + i * 2, "%02x", digest[i]);
+
+    printf(" ran %i gametics in %i ms (%.2f tics/s)\n", gametics, wallms, tps);
+    printf(" state %s\n", hash);
+
+    C_Printf(" ran %i gametics in %i ms (%.2f tics/s)\n", gametics, wallms, tps);
+    C_Printf(" state %s\n", hash);
+}
  
  
 /* 
@@ -2070,7 +2249,7 @@ void G_TimeDemo (char* name)
 */ 
 boolean G_CheckDemoStatus(void)
 {
-    int     i, endtime;
+    int     i;
     char    lbmname[10];
 
     FILE    *test_access;
@@ -2093,9 +2272,14 @@ boolean G_CheckDemoStatus(void)
 
     if (timingdemo)
     {
-        endtime = I_GetTime();
-        I_Error("timed %i gametics in %i realtics", gametic,
-                endtime - starttime);
+        G_TimeDemoReport();
+        I_Quit();
+    }
+
+    if (fastdemo)
+    {
+        G_FastDemoReport();
+        I_Quit();
     }
 
     if (demoplayback)
@@ -65,6 +65,8 @@ void G_BeginRecording (void);
 
 void G_PlayDemo (char* name);
 void G_TimeDemo (char* name);
+void G_FastDemo (char* name);
+void G_TimeDemoFrame (unsigned int start, unsigned int end);
 boolean G_CheckDemoStatus (void);
 
 void G_ExitLevel (void);
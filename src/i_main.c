@@ -33,6 +33,7 @@
 #include "doomtype.h"
 #include "i_system.h"
 #include "i_wiimain.h"
+#include "m_argv.h"
 #include "xmn_main.h"
 
 
@@ -50,6 +51,11 @@ int user_main()
 
 int main(int argc, char **argv)
 {
+    // save arguments
+
+    myargc = argc;
+    myargv = argv;
+
     // start doom
 
     wii_main();
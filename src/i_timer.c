@@ -26,6 +26,8 @@
 
 
 #include <SDL/SDL.h>
+#include <stdlib.h>
+#include <sys/time.h>
 
 #include "doomtype.h"
 #include "i_timer.h"
@@ -68,6 +70,20 @@ int I_GetTimeMS(void)
     return ticks - basetime;
 }
 
+//
+// Same as I_GetTimeMS, but returns time in microseconds.  Only the
+// difference between two calls is meaningful; the value wraps.
+//
+
+unsigned int I_GetTimeUS(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
 // Sleep for a specified number of ms
 
 void I_Sleep(int ms)
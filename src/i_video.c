@@ -37,6 +37,7 @@
 #include "i_scale.h"
 #include "m_config.h"
 #include "m_misc.h"
+#include "r_prof.h"
 #include "tables.h"
 #include "v_video.h"
 #include "w_wad.h"
@@ -375,7 +376,9 @@ static void FinishUpdateSoftware(void)
 {
     // draw to screen
 
+    R_ProfStart(PROF_SCALE);
     BlitArea(0, 0, SCREENWIDTH, SCREENHEIGHT);
+    R_ProfStop(PROF_SCALE);
 
     if (palette_to_set)
     {
@@ -618,7 +621,9 @@ void I_FinishUpdate (void)
             I_VideoBuffer[ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0x0;
     }
 
+    R_ProfStart(PROF_FINISH);
     FinishUpdateSoftware();
+    R_ProfStop(PROF_FINISH);
 }
 
 
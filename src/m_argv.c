@@ -0,0 +1,65 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+// DESCRIPTION:
+//        Command line arguments.  On the Wii these are the ones given
+//        in the <arguments> section of the Homebrew Channel meta.xml.
+//
+//-----------------------------------------------------------------------------
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "doomtype.h"
+#include "m_argv.h"
+
+
+int             myargc;
+char**          myargv;
+
+
+//
+// M_CheckParm
+// Checks for the given parameter
+// in the program's command line arguments.
+// Returns the argument number (1 to argc-1)
+// or 0 if not present
+//
+
+int M_CheckParmWithArgs(char *check, int num_args)
+{
+    int i;
+
+    for (i = 1; i < myargc - num_args; i++)
+    {
+        if (!strcasecmp(check, myargv[i]))
+            return i;
+    }
+
+    return 0;
+}
+
+int M_CheckParm(char *check)
+{
+    return M_CheckParmWithArgs(check, 0);
+}
+
@@ -51,6 +51,7 @@
 #include "p_local.h"
 #include "p_saveg.h"
 #include "r_local.h"
+#include "r_prof.h"
 #include "s_sound.h"
 
 // Data.
@@ -1019,6 +1020,7 @@ void M_KeyBindingsReset (int choice);
 void M_KeyBindingsSetKey(int choice);
 void M_KeyBindings(int choice);
 void M_FPS(int choice);
+void M_RenderProfile(int choice);
 void M_DisplayTicker(int choice);
 void M_Coordinates(int choice);
 void M_Timer(int choice);
@@ -1627,13 +1629,15 @@ enum
 {
     system_fps,
     system_ticker,
+    system_profile,
     system_end
 } system_e;
 
 menuitem_t SystemMenu[]=
 {
     {2,"M_FPSCNT",M_FPS,'f'},
-    {2,"M_DPLTCK",M_DisplayTicker,'t'}
+    {2,"M_DPLTCK",M_DisplayTicker,'t'},
+    {2,"",M_RenderProfile,'r'}
 };
 
 menu_t  SystemDef =
@@ -5552,6 +5556,16 @@ void M_FPS(int choice)
     }
 }
 
+void M_RenderProfile(int choice)
+{
+    display_profile = !display_profile;
+
+    if(display_profile)
+        players[consoleplayer].message = DEH_String("RENDER PROFILE ON");
+    else
+        players[consoleplayer].message = DEH_String("RENDER PROFILE OFF");
+}
+
 u64 GetTicks(void)
 {
     return (u64)SDL_GetTicks();
@@ -5578,6 +5592,13 @@ void M_FPSCounter(int display_fps)
     {
         M_WriteText(0, 30, fpsDisplay);
     }
+
+    // stage times and view counts, toggled in the system menu, with
+    // -profile or with "profile" at the console
+    if(display_profile && gamestate == GS_LEVEL)
+    {
+        R_ProfDraw(0, 42);
+    }
     BorderNeedRefresh = true;
 }
 
@@ -6092,6 +6113,14 @@ void M_DrawSystem(void)
         V_DrawPatch (244, 101, W_CacheLumpName(DEH_String("M_MSGON"), PU_CACHE));
     else
         V_DrawPatch (244, 101, W_CacheLumpName(DEH_String("M_MSGOFF"), PU_CACHE));
+
+    // there is no graphic for this one
+    M_WriteText(SystemDef.x, 121, DEH_String("RENDER PROFILE"));
+
+    if(display_profile)
+        V_DrawPatch (244, 117, W_CacheLumpName(DEH_String("M_MSGON"), PU_CACHE));
+    else
+        V_DrawPatch (244, 117, W_CacheLumpName(DEH_String("M_MSGOFF"), PU_CACHE));
 }
 
 void M_HUD(int choice)
@@ -284,7 +284,7 @@ EV_DoDoor
         
         // new door thinker
         rtn = 1;
-        door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+        door = Z_PoolAlloc (&doorpool);
         P_AddThinker (&door->thinker);
         sec->specialdata = door;
 
@@ -495,7 +495,7 @@ EV_VerticalDoor
         
     
     // new door thinker
-    door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+    door = Z_PoolAlloc (&doorpool);
     P_AddThinker (&door->thinker);
     sec->specialdata = door;
     door->thinker.function.acp1 = (actionf_p1) T_VerticalDoor;
@@ -545,7 +545,7 @@ void P_SpawnDoorCloseIn30 (sector_t* sec)
 {
     vldoor_t*        door;
         
-    door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
+    door = Z_PoolAlloc (&doorpool);
 
     P_AddThinker (&door->thinker);
 
@@ -570,7 +570,7 @@ P_SpawnDoorRaiseIn5Mins
 {
     vldoor_t*      door;
         
-    door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
+    door = Z_PoolAlloc (&doorpool);
     
     P_AddThinker (&door->thinker);
 
@@ -279,7 +279,7 @@ EV_DoFloor
         
         // new floor thinker
         rtn = 1;
-        floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+        floor = Z_PoolAlloc (&floorpool);
         P_AddThinker (&floor->thinker);
         sec->specialdata = floor;
         floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -502,7 +502,7 @@ EV_BuildStairs
         
         // new floor thinker
         rtn = 1;
-        floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+        floor = Z_PoolAlloc (&floorpool);
         P_AddThinker (&floor->thinker);
         sec->specialdata = floor;
         floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -559,7 +559,7 @@ EV_BuildStairs
                                         
                 sec = tsec;
                 secnum = newsecnum;
-                floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+                floor = Z_PoolAlloc (&floorpool);
 
                 P_AddThinker (&floor->thinker);
 
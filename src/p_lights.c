@@ -74,7 +74,7 @@ void P_SpawnFireFlicker (sector_t*        sector)
     // Nothing special about it during gameplay.
     sector->special = 0; 
         
-    flick = Z_Malloc ( sizeof(*flick), PU_LEVSPEC, 0);
+    flick = Z_PoolAlloc (&flickerpool);
 
     P_AddThinker (&flick->thinker);
 
@@ -129,7 +129,7 @@ void P_SpawnLightFlash (sector_t*        sector)
     // nothing special about it during gameplay
     sector->special = 0;        
         
-    flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
+    flash = Z_PoolAlloc (&flashpool);
 
     P_AddThinker (&flash->thinker);
 
@@ -186,7 +186,7 @@ P_SpawnStrobeFlash
 {
     strobe_t*        flash;
         
-    flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
+    flash = Z_PoolAlloc (&strobepool);
 
     P_AddThinker (&flash->thinker);
 
@@ -343,7 +343,7 @@ void P_SpawnGlowingLight(sector_t*        sector)
 {
     glow_t*        g;
         
-    g = Z_Malloc( sizeof(*g), PU_LEVSPEC, 0);
+    g = Z_PoolAlloc (&glowpool);
 
     P_AddThinker(&g->thinker);
 
@@ -32,6 +32,8 @@
 #include "r_local.h"
 #endif
 
+#include "z_zone.h"
+
 #define FLOOR_SOLID         0
 #define FLOOR_WATER         1
 #define FLOOR_LAVA          2
@@ -76,6 +78,18 @@
 extern        thinker_t        thinkercap;        
 
 
+// pools the thinkers are allocated from
+extern        mempool_t        mobjpool;
+extern        mempool_t        doorpool;
+extern        mempool_t        floorpool;
+extern        mempool_t        platpool;
+extern        mempool_t        ceilingpool;
+extern        mempool_t        flickerpool;
+extern        mempool_t        flashpool;
+extern        mempool_t        strobepool;
+extern        mempool_t        glowpool;
+
+
 void P_InitThinkers (void);
 void P_AddThinker (thinker_t* thinker);
 void P_RemoveThinker (thinker_t* thinker);
@@ -1652,8 +1652,8 @@ void P_UnArchiveThinkers (void)
         
         if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
             P_RemoveMobj ((mobj_t *)currentthinker);
-        else
-            Z_Free (currentthinker);
+
+        Z_PoolFree (currentthinker);
 
         currentthinker = next;
     }
@@ -1670,7 +1670,7 @@ void P_UnArchiveThinkers (void)
                         
           case tc_mobj:
             saveg_read_pad();
-            mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
+            mobj = Z_PoolAlloc (&mobjpool);
             saveg_read_mobj_t(mobj);
 
             mobj->target = NULL;
@@ -1834,7 +1834,7 @@ void P_UnArchiveSpecials (void)
                         
           case tc_ceiling:
             saveg_read_pad();
-            ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVEL, NULL);
+            ceiling = Z_PoolAlloc (&ceilingpool);
             saveg_read_ceiling_t(ceiling);
             ceiling->sector->specialdata = ceiling;
 
@@ -1847,7 +1847,7 @@ void P_UnArchiveSpecials (void)
                                 
           case tc_door:
             saveg_read_pad();
-            door = Z_Malloc (sizeof(*door), PU_LEVEL, NULL);
+            door = Z_PoolAlloc (&doorpool);
             saveg_read_vldoor_t(door);
             door->sector->specialdata = door;
             door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
@@ -1856,7 +1856,7 @@ void P_UnArchiveSpecials (void)
                                 
           case tc_floor:
             saveg_read_pad();
-            floor = Z_Malloc (sizeof(*floor), PU_LEVEL, NULL);
+            floor = Z_PoolAlloc (&floorpool);
             saveg_read_floormove_t(floor);
             floor->sector->specialdata = floor;
             floor->thinker.function.acp1 = (actionf_p1)T_MoveFloor;
@@ -1865,7 +1865,7 @@ void P_UnArchiveSpecials (void)
                                 
           case tc_plat:
             saveg_read_pad();
-            plat = Z_Malloc (sizeof(*plat), PU_LEVEL, NULL);
+            plat = Z_PoolAlloc (&platpool);
             saveg_read_plat_t(plat);
             plat->sector->specialdata = plat;
 
@@ -1878,7 +1878,7 @@ void P_UnArchiveSpecials (void)
                                 
           case tc_flash:
             saveg_read_pad();
-            flash = Z_Malloc (sizeof(*flash), PU_LEVEL, NULL);
+            flash = Z_PoolAlloc (&flashpool);
             saveg_read_lightflash_t(flash);
             flash->thinker.function.acp1 = (actionf_p1)T_LightFlash;
             P_AddThinker (&flash->thinker);
@@ -1886,7 +1886,7 @@ void P_UnArchiveSpecials (void)
                                 
           case tc_strobe:
             saveg_read_pad();
-            strobe = Z_Malloc (sizeof(*strobe), PU_LEVEL, NULL);
+            strobe = Z_PoolAlloc (&strobepool);
             saveg_read_strobe_t(strobe);
             strobe->thinker.function.acp1 = (actionf_p1)T_StrobeFlash;
             P_AddThinker (&strobe->thinker);
@@ -1894,7 +1894,7 @@ void P_UnArchiveSpecials (void)
                                 
           case tc_glow:
             saveg_read_pad();
-            glow = Z_Malloc (sizeof(*glow), PU_LEVEL, NULL);
+            glow = Z_PoolAlloc (&glowpool);
             saveg_read_glow_t(glow);
             glow->thinker.function.acp1 = (actionf_p1)T_Glow;
             P_AddThinker (&glow->thinker);
@@ -40,6 +40,7 @@
 #include "m_bbox.h"
 #include "p_local.h"
 #include "s_sound.h"
+#include "w_prefetch.h"
 #include "w_wad.h"
 #include "z_zone.h"
 
@@ -131,7 +132,7 @@ void P_LoadVertexes (int lump)
     numvertexes = W_LumpLength (lump) / sizeof(mapvertex_t);
 
     // Allocate zone memory for buffer.
-    vertexes = Z_Malloc (numvertexes*sizeof(vertex_t),PU_LEVEL,0);        
+    vertexes = Z_LevelMalloc (numvertexes*sizeof(vertex_t));        
 
     // Load data into cache.
     data = W_CacheLumpNum (lump, PU_STATIC);
@@ -185,7 +186,7 @@ void P_LoadSegs (int lump)
     int            sidenum;
         
     numsegs = W_LumpLength (lump) / sizeof(mapseg_t);
-    segs = Z_Malloc (numsegs*sizeof(seg_t),PU_LEVEL,0);        
+    segs = Z_LevelMalloc (numsegs*sizeof(seg_t));        
     memset (segs, 0, numsegs*sizeof(seg_t));
     data = W_CacheLumpNum (lump,PU_STATIC);
         
@@ -245,7 +246,7 @@ void P_LoadSubsectors (int lump)
     subsector_t*    ss;
         
     numsubsectors = W_LumpLength (lump) / sizeof(mapsubsector_t);
-    subsectors = Z_Malloc (numsubsectors*sizeof(subsector_t),PU_LEVEL,0);        
+    subsectors = Z_LevelMalloc (numsubsectors*sizeof(subsector_t));        
     data = W_CacheLumpNum (lump,PU_STATIC);
         
     ms = (mapsubsector_t *)data;
@@ -274,7 +275,7 @@ void P_LoadSectors (int lump)
     sector_t*       ss;
         
     numsectors = W_LumpLength (lump) / sizeof(mapsector_t);
-    sectors = Z_Malloc (numsectors*sizeof(sector_t),PU_LEVEL,0);        
+    sectors = Z_LevelMalloc (numsectors*sizeof(sector_t));        
     memset (sectors, 0, numsectors*sizeof(sector_t));
     data = W_CacheLumpNum (lump,PU_STATIC);
         
@@ -311,7 +312,7 @@ void P_LoadNodes (int lump)
     node_t*         no;
         
     numnodes = W_LumpLength (lump) / sizeof(mapnode_t);
-    nodes = Z_Malloc (numnodes*sizeof(node_t),PU_LEVEL,0);        
+    nodes = Z_LevelMalloc (numnodes*sizeof(node_t));        
     data = W_CacheLumpNum (lump,PU_STATIC);
         
     mn = (mapnode_t *)data;
@@ -405,7 +406,7 @@ void P_LoadLineDefs (int lump)
     vertex_t*       v2;
         
     numlines = W_LumpLength (lump) / sizeof(maplinedef_t);
-    lines = Z_Malloc (numlines*sizeof(line_t),PU_LEVEL,0);        
+    lines = Z_LevelMalloc (numlines*sizeof(line_t));        
     memset (lines, 0, numlines*sizeof(line_t));
     data = W_CacheLumpNum (lump,PU_STATIC);
         
@@ -484,7 +485,7 @@ void P_LoadSideDefs (int lump)
     side_t*         sd;
         
     numsides = W_LumpLength (lump) / sizeof(mapsidedef_t);
-    sides = Z_Malloc (numsides*sizeof(side_t),PU_LEVEL,0);        
+    sides = Z_LevelMalloc (numsides*sizeof(side_t));        
     memset (sides, 0, numsides*sizeof(side_t));
     data = W_CacheLumpNum (lump,PU_STATIC);
         
@@ -516,7 +517,7 @@ void P_LoadBlockMap (int lump)
     lumplen = W_LumpLength(lump);
     count = lumplen / 2;
         
-    blockmaplump = Z_Malloc(lumplen, PU_LEVEL, NULL);
+    blockmaplump = Z_LevelMalloc(lumplen);
     W_ReadLump(lump, blockmaplump);
     blockmap = blockmaplump + 4;
 
@@ -537,7 +538,7 @@ void P_LoadBlockMap (int lump)
     // Clear out mobj chains
 
     count = sizeof(*blocklinks) * bmapwidth * bmapheight;
-    blocklinks = Z_Malloc(count, PU_LEVEL, 0);
+    blocklinks = Z_LevelMalloc(count);
     memset(blocklinks, 0, count);
 }
 
@@ -584,7 +585,7 @@ void P_GroupLines (void)
     }
 
     // build line tables for each sector        
-    linebuffer = Z_Malloc (totallines*sizeof(line_t *), PU_LEVEL, 0);
+    linebuffer = Z_LevelMalloc (totallines*sizeof(line_t *));
 
     for (i=0; i<numsectors; ++i)
     {
@@ -774,13 +775,104 @@ static void P_LoadReject(int lumpnum)
     }
     else
     {
-        rejectmatrix = Z_Malloc(minlength, PU_LEVEL, &rejectmatrix);
+        rejectmatrix = Z_LevelMalloc(minlength);
         W_ReadLump(lumpnum, rejectmatrix);
 
         PadRejectArray(rejectmatrix + lumplen, minlength - lumplen);
     }
 }
 
+//
+// P_GetMapLumpNum
+// Returns the lump number of a map, or -1 if it is not in the WAD.
+//
+static int P_GetMapLumpNum (int episode, int map, char *lumpname)
+{
+    int              lumpnum;
+
+    // find map name
+    if ( gamemode == commercial)
+    {
+        if (map<10)
+            DEH_snprintf(lumpname, 9, "map0%i", map);
+        else
+            DEH_snprintf(lumpname, 9, "map%i", map);
+    }
+    else
+    {
+        if(fsize != 12538385 || (fsize == 12538385 && map < 10))
+        {
+            lumpname[0] = 'E';
+            lumpname[1] = '0' + episode;
+            lumpname[2] = 'M';
+            lumpname[3] = '0' + map;
+            lumpname[4] = 0;
+        }
+        else
+            DEH_snprintf(lumpname, 9, "e1m10");
+    }
+
+    lumpnum = W_CheckNumForName (lumpname);
+
+    if (lumpnum >= 0 && nerve_pwad && gamemission != pack_nerve)
+    {
+        lumpnum = W_GetSecondNumForName (lumpname);
+    }
+
+    return lumpnum;
+}
+
+// Map whose lumps and graphics have been queued for loading, and map
+// waiting for its lumps to be read before its graphics can be queued.
+
+static int prefetch_lumpnum = -1;
+static int pending_lumpnum = -1;
+
+static void P_PrefetchMap (int lumpnum)
+{
+    int              i;
+
+    for (i=ML_THINGS ; i<=ML_BLOCKMAP && lumpnum+i<(int) numlumps ; i++)
+        W_PrefetchLump (lumpnum+i);
+}
+
+//
+// P_PrefetchLevel
+// Starts loading the next level in the background, as soon as it is
+// known.  The graphics are queued by P_PrefetchTicker once the map
+// lumps saying which are needed have been read.
+//
+void P_PrefetchLevel (int episode, int map)
+{
+    char             lumpname[9];
+    int              lumpnum;
+
+    lumpnum = P_GetMapLumpNum (episode, map, lumpname);
+
+    if (lumpnum < 0 || lumpnum == prefetch_lumpnum)
+        return;
+
+    P_PrefetchMap (lumpnum);
+    pending_lumpnum = lumpnum;
+}
+
+void P_PrefetchTicker (void)
+{
+    if (pending_lumpnum < 0
+     || W_PrefetchPending (pending_lumpnum+ML_THINGS)
+     || W_PrefetchPending (pending_lumpnum+ML_SIDEDEFS)
+     || W_PrefetchPending (pending_lumpnum+ML_SECTORS))
+    {
+        return;
+    }
+
+    if (precache)
+        R_PrefetchLevel (pending_lumpnum);
+
+    prefetch_lumpnum = pending_lumpnum;
+    pending_lumpnum = -1;
+}
+
 //
 // P_SetupLevel
 //
@@ -813,43 +905,38 @@ P_SetupLevel
     // will be set by player think.
     players[consoleplayer].viewz = 1; 
 
+    W_PrefetchResetStats ();
+
     // Make sure all sounds are stopped before Z_FreeTags.
     S_Start ();                        
 
     Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+    Z_LevelReset ();
 
     // UNUSED W_Profile ();
     P_InitThinkers ();
            
-    // find map name
-    if ( gamemode == commercial)
-    {
-        if (map<10)
-            DEH_snprintf(lumpname, 9, "map0%i", map);
-        else
-            DEH_snprintf(lumpname, 9, "map%i", map);
-    }
-    else
+    lumpnum = P_GetMapLumpNum (episode, map, lumpname);
+
+    if (lumpnum < 0)
     {
-        if(fsize != 12538385 || (fsize == 12538385 && map < 10))
-        {
-            lumpname[0] = 'E';
-            lumpname[1] = '0' + episode;
-            lumpname[2] = 'M';
-            lumpname[3] = '0' + map;
-            lumpname[4] = 0;
-        }
-        else
-            DEH_snprintf(lumpname, 9, "e1m10");
+        I_Error ("W_GetNumForName: %s not found!", lumpname);
     }
 
-    lumpnum = W_GetNumForName (lumpname);
+    // Queue the map and its graphics to be read while the level is
+    // being set up, unless it was done during the intermission.
 
-    if (nerve_pwad && gamemission != pack_nerve)
+    if (lumpnum != prefetch_lumpnum)
     {
-        lumpnum = W_GetSecondNumForName (lumpname);
+        P_PrefetchMap (lumpnum);
+
+        if (precache)
+            R_PrefetchLevel (lumpnum);
     }
 
+    prefetch_lumpnum = -1;
+    pending_lumpnum = -1;
+
     leveltime = 0;
         
     // note: most of this ordering is important        
@@ -898,8 +985,13 @@ P_SetupLevel
     if (precache)
         R_PrecacheLevel ();
 
+    W_PrefetchFinish ();
+
     //printf ("free memory: 0x%x\n", Z_FreeMemory());
 
+    C_Printf(" level arena: %i of %i bytes used\n",
+             Z_LevelArenaUsed(), Z_LevelArenaSize());
+
     C_Printf(" HU_NewLevel executed\n");
 
     HU_NewLevel();
@@ -39,6 +39,10 @@ P_SetupLevel
   int                playermask,
   skill_t            skill);
 
+// Load the next level in the background during the intermission.
+void P_PrefetchLevel (int episode, int map);
+void P_PrefetchTicker (void);
+
 // Called by startup code.
 void P_Init (void);
 
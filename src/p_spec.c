@@ -1314,7 +1314,7 @@ int EV_DoDonut(line_t*       line)
             }
 
             //        Spawn rising slime
-            floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+            floor = Z_PoolAlloc (&floorpool);
             P_AddThinker (&floor->thinker);
             s2->specialdata = floor;
             floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -1328,7 +1328,7 @@ int EV_DoDonut(line_t*       line)
             floor->floordestheight = s3_floorheight;
             
             //        Spawn lowering donut-hole
-            floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+            floor = Z_PoolAlloc (&floorpool);
             P_AddThinker (&floor->thinker);
             s1->specialdata = floor;
             floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
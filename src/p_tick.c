@@ -28,12 +28,14 @@
 
 #include "doomstat.h"
 #include "p_local.h"
+#include "p_tick.h"
+#include "sha1.h"
 #include "z_zone.h"
 
 
 //
 // THINKERS
-// All thinkers should be allocated by Z_Malloc
+// All thinkers should be allocated from a pool
 // so they can be operated on uniformly.
 // The actual structures will vary in size,
 // but the first element must be thinker_t.
@@ -45,6 +47,17 @@ int              leveltime;
 // Both the head and tail of the thinker list.
 thinker_t        thinkercap;
 
+// Pools every thinker is allocated from.
+mempool_t        mobjpool = { sizeof(mobj_t) };
+mempool_t        doorpool = { sizeof(vldoor_t) };
+mempool_t        floorpool = { sizeof(floormove_t) };
+mempool_t        platpool = { sizeof(plat_t) };
+mempool_t        ceilingpool = { sizeof(ceiling_t) };
+mempool_t        flickerpool = { sizeof(fireflicker_t) };
+mempool_t        flashpool = { sizeof(lightflash_t) };
+mempool_t        strobepool = { sizeof(strobe_t) };
+mempool_t        glowpool = { sizeof(glow_t) };
+
 
 //
 // P_InitThinkers
@@ -110,7 +123,7 @@ void P_RunThinkers (void)
             // time to remove it
             currentthinker->next->prev = currentthinker->prev;
             currentthinker->prev->next = currentthinker->next;
-            Z_Free (currentthinker);
+            Z_PoolFree (currentthinker);
         }
         else
         {
@@ -157,3 +170,71 @@ void P_Ticker (void)
     leveltime++;        
 }
 
+
+//
+// P_Checksum
+// Hashes the parts of the level state a demo run can diverge in:
+// the random index, every mobj, the sector heights and the players.
+// Two builds playing the same demo must end with the same digest.
+//
+
+extern int prndindex;
+
+void P_Checksum (sha1_digest_t digest)
+{
+    sha1_context_t      sha1_context;
+    thinker_t*          th;
+    mobj_t*             mo;
+    sector_t*           sec;
+    player_t*           player;
+    int                 i;
+
+    SHA1_Init(&sha1_context);
+
+    SHA1_UpdateInt32(&sha1_context, leveltime);
+    SHA1_UpdateInt32(&sha1_context, prndindex);
+
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+    {
+        if (th->function.acp1 != (actionf_p1) P_MobjThinker)
+            continue;
+
+        mo = (mobj_t *) th;
+
+        SHA1_UpdateInt32(&sha1_context, mo->type);
+        SHA1_UpdateInt32(&sha1_context, mo->x);
+        SHA1_UpdateInt32(&sha1_context, mo->y);
+        SHA1_UpdateInt32(&sha1_context, mo->z);
+        SHA1_UpdateInt32(&sha1_context, mo->angle);
+        SHA1_UpdateInt32(&sha1_context, mo->momx);
+        SHA1_UpdateInt32(&sha1_context, mo->momy);
+        SHA1_UpdateInt32(&sha1_context, mo->momz);
+        SHA1_UpdateInt32(&sha1_context, mo->health);
+        SHA1_UpdateInt32(&sha1_context, mo->flags);
+        SHA1_UpdateInt32(&sha1_context, mo->state - states);
+        SHA1_UpdateInt32(&sha1_context, mo->tics);
+    }
+
+    for (i = 0, sec = sectors ; i < numsectors ; i++, sec++)
+    {
+        SHA1_UpdateInt32(&sha1_context, sec->floorheight);
+        SHA1_UpdateInt32(&sha1_context, sec->ceilingheight);
+        SHA1_UpdateInt32(&sha1_context, sec->lightlevel);
+    }
+
+    for (i = 0 ; i < MAXPLAYERS ; i++)
+    {
+        if (!playeringame[i])
+            continue;
+
+        player = &players[i];
+
+        SHA1_UpdateInt32(&sha1_context, player->health);
+        SHA1_UpdateInt32(&sha1_context, player->armorpoints);
+        SHA1_UpdateInt32(&sha1_context, player->killcount);
+        SHA1_UpdateInt32(&sha1_context, player->itemcount);
+        SHA1_UpdateInt32(&sha1_context, player->secretcount);
+    }
+
+    SHA1_Final(digest, &sha1_context);
+}
@@ -28,11 +28,16 @@
 #ifndef __P_TICK__
 #define __P_TICK__
 
+#include "sha1.h"
+
 
 // Called by C_Ticker,
 // can call G_PlayerExited.
 // Carries out all thinking of monsters and players.
 void P_Ticker (void);
 
+// Hash of the play simulation state, for comparing demo runs.
+void P_Checksum (sha1_digest_t digest);
+
 
 #endif
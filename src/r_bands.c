@@ -0,0 +1,341 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//
+// DESCRIPTION:
+//        Column and span drawing split across threads.
+//
+//        With -renderthreads, the BSP walk, clipping, planes and
+//        sprites are still worked out by the main thread, but colfunc
+//        and spanfunc only queue their draws.  When the view is done,
+//        or the queue fills, the view is cut into as many vertical
+//        bands as there are threads, and each thread carries out every
+//        queued draw in order, clipped to its own band.  No pixel is
+//        written by two threads, and each band sees its draws in the
+//        same order as before, so the picture is the same as drawing
+//        everything on one thread.
+//
+//-----------------------------------------------------------------------------
+
+
+#include <SDL/SDL.h>
+#include <stdlib.h>
+
+#include "doomdef.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "r_bands.h"
+#include "r_local.h"
+#include "z_zone.h"
+
+
+#define MAXBANDTHREADS          8
+
+// Draws queued before the queue is carried out anyway.
+#define MAXBANDCMDS             8192
+
+typedef struct
+{
+    // One of these is set.
+    void                (*colkernel) (drawcolumn_t *dc);
+    void                (*spankernel) (drawspan_t *ds);
+
+    union
+    {
+        drawcolumn_t    column;
+        drawspan_t      span;
+    } u;
+} bandcmd_t;
+
+static bandcmd_t*       bandcmds;
+static int              numbandcmds;
+
+static int              numbandthreads = 1;
+static SDL_Thread*      bandthreads[MAXBANDTHREADS];
+
+// The band mutex is held while the generation or the number of
+//  threads still drawing is being accessed.  start_cond is signalled
+//  when there is a new generation of draws to carry out, and
+//  done_cond when the last thread has finished its band.
+static SDL_mutex*       band_mutex;
+static SDL_cond*        start_cond;
+static SDL_cond*        done_cond;
+static int              generation;
+static int              bandsdrawing;
+
+// Kernels for the current detail level
+static void             (*colkernel) (drawcolumn_t *dc);
+static void             (*fuzzkernel) (drawcolumn_t *dc);
+static void             (*transkernel) (drawcolumn_t *dc);
+static void             (*spankernel) (drawspan_t *ds);
+
+
+//
+// R_DrawBand
+// Carries out the queued draws that touch columns x1 up to x2.
+//
+static void R_DrawBand (int x1, int x2)
+{
+    bandcmd_t*          cmd;
+    drawcolumn_t        dc;
+    drawspan_t          ds;
+    int                 i;
+
+    for (i = 0, cmd = bandcmds ; i < numbandcmds ; i++, cmd++)
+    {
+        if (cmd->colkernel)
+        {
+            if (cmd->u.column.x < x1 || cmd->u.column.x > x2)
+                continue;
+
+            // the kernels change their copy
+            dc = cmd->u.column;
+            cmd->colkernel (&dc);
+        }
+        else
+        {
+            if (cmd->u.span.x2 < x1 || cmd->u.span.x1 > x2)
+                continue;
+
+            ds = cmd->u.span;
+
+            // skip ahead to the band, as many steps as the
+            //  drawer would have taken to get there
+            if (ds.x1 < x1)
+            {
+                ds.position += (x1 - ds.x1) * ds.step;
+                ds.x1 = x1;
+            }
+
+            if (ds.x2 > x2)
+                ds.x2 = x2;
+
+            cmd->spankernel (&ds);
+        }
+    }
+}
+
+
+static void R_BandBounds (int band, int* x1, int* x2)
+{
+    *x1 = band * viewwidth / numbandthreads;
+    *x2 = (band + 1) * viewwidth / numbandthreads - 1;
+}
+
+
+static int R_BandThread (void* arg)
+{
+    int                 band = (int) (intptr_t) arg;
+    int                 seen;
+    int                 x1;
+    int                 x2;
+
+    SDL_LockMutex (band_mutex);
+    seen = generation;
+
+    for (;;)
+    {
+        while (generation == seen)
+            SDL_CondWait (start_cond, band_mutex);
+
+        seen = generation;
+        SDL_UnlockMutex (band_mutex);
+
+        R_BandBounds (band, &x1, &x2);
+        R_DrawBand (x1, x2);
+
+        SDL_LockMutex (band_mutex);
+
+        if (--bandsdrawing == 0)
+            SDL_CondSignal (done_cond);
+    }
+
+    return 0;
+}
+
+
+//
+// R_FlushBands
+//
+void R_FlushBands (void)
+{
+    int                 x1;
+    int                 x2;
+
+    if (numbandcmds == 0)
+        return;
+
+    SDL_LockMutex (band_mutex);
+    bandsdrawing = numbandthreads - 1;
+    generation++;
+    SDL_CondBroadcast (start_cond);
+    SDL_UnlockMutex (band_mutex);
+
+    // the main thread draws the first band
+    R_BandBounds (0, &x1, &x2);
+    R_DrawBand (x1, x2);
+
+    SDL_LockMutex (band_mutex);
+
+    while (bandsdrawing > 0)
+        SDL_CondWait (done_cond, band_mutex);
+
+    SDL_UnlockMutex (band_mutex);
+
+    numbandcmds = 0;
+}
+
+
+static bandcmd_t* R_NewBandCmd (void)
+{
+    if (numbandcmds == MAXBANDCMDS)
+        R_FlushBands ();
+
+    return &bandcmds[numbandcmds++];
+}
+
+
+static void R_QueueColumn (void)
+{
+    bandcmd_t*          cmd = R_NewBandCmd ();
+
+    cmd->colkernel = colkernel;
+    cmd->spankernel = NULL;
+    R_SaveColumn (&cmd->u.column);
+}
+
+
+static void R_QueueTranslatedColumn (void)
+{
+    bandcmd_t*          cmd = R_NewBandCmd ();
+
+    cmd->colkernel = transkernel;
+    cmd->spankernel = NULL;
+    R_SaveColumn (&cmd->u.column);
+}
+
+
+static void R_QueueFuzzColumn (void)
+{
+    bandcmd_t*          cmd = R_NewBandCmd ();
+    int                 yl;
+    int                 yh;
+
+    cmd->colkernel = fuzzkernel;
+    cmd->spankernel = NULL;
+    R_SaveColumn (&cmd->u.column);
+
+    // Step the fuzz table on as far as the drawer will, so the next
+    //  fuzzy column starts where it would have.
+    yl = dc_yl ? dc_yl : 1;
+    yh = dc_yh == viewheight - 1 ? viewheight - 2 : dc_yh;
+
+    if (yh >= yl)
+        fuzzpos = (fuzzpos + yh - yl + 1) % FUZZTABLE;
+}
+
+
+static void R_QueueSpan (void)
+{
+    bandcmd_t*          cmd = R_NewBandCmd ();
+
+    cmd->colkernel = NULL;
+    cmd->spankernel = spankernel;
+    R_SaveSpan (&cmd->u.span);
+}
+
+
+//
+// R_SetBandFuncs
+//
+void R_SetBandFuncs (void)
+{
+    if (numbandthreads < 2)
+        return;
+
+    if (!detailshift)
+    {
+        colkernel = R_DrawColumnKernel;
+        fuzzkernel = R_DrawFuzzColumnKernel;
+        transkernel = R_DrawTranslatedColumnKernel;
+        spankernel = drawspankernel;
+    }
+    else
+    {
+        colkernel = R_DrawColumnLowKernel;
+        fuzzkernel = R_DrawFuzzColumnLowKernel;
+        transkernel = R_DrawTranslatedColumnLowKernel;
+        spankernel = drawspanlowkernel;
+    }
+
+    colfunc = basecolfunc = R_QueueColumn;
+    fuzzcolfunc = R_QueueFuzzColumn;
+    transcolfunc = R_QueueTranslatedColumn;
+    spanfunc = R_QueueSpan;
+}
+
+
+//
+// R_InitBands
+//
+void R_InitBands (void)
+{
+    int                 p;
+    int                 i;
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // Split drawing of the view across n threads (at most 8).
+    //
+
+    p = M_CheckParmWithArgs ("-renderthreads", 1);
+
+    if (!p)
+        return;
+
+    numbandthreads = atoi (myargv[p+1]);
+
+    if (numbandthreads < 1 || numbandthreads > MAXBANDTHREADS)
+        I_Error ("R_InitBands: -renderthreads must be from 1 to %i",
+                 MAXBANDTHREADS);
+
+    if (numbandthreads == 1)
+        return;
+
+    bandcmds = Z_Malloc (MAXBANDCMDS * sizeof(*bandcmds), PU_STATIC, NULL);
+    numbandcmds = 0;
+
+    band_mutex = SDL_CreateMutex ();
+    start_cond = SDL_CreateCond ();
+    done_cond = SDL_CreateCond ();
+
+    for (i = 1 ; i < numbandthreads ; i++)
+    {
+        bandthreads[i] = SDL_CreateThread (R_BandThread,
+                                           (void *) (intptr_t) i);
+
+        if (bandthreads[i] == NULL)
+            I_Error ("R_InitBands: failed to start drawing thread %i", i);
+    }
+}
+
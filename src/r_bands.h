@@ -0,0 +1,43 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//
+// DESCRIPTION:
+//        Column and span drawing split across threads.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __R_BANDS__
+#define __R_BANDS__
+
+
+// Start the drawing threads asked for with -renderthreads.
+void R_InitBands (void);
+
+// Have colfunc and spanfunc queue their draws when drawing is
+//  split across threads.  Called when the detail level changes.
+void R_SetBandFuncs (void);
+
+// Carry out every queued draw.
+void R_FlushBands (void);
+
+#endif
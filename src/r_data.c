@@ -39,6 +39,7 @@
 #include "r_data.h"
 #include "r_local.h"
 #include "r_sky.h"
+#include "w_prefetch.h"
 #include "w_wad.h"
 #include "z_zone.h"
 
@@ -526,6 +527,8 @@ R_GetColumn
 
     if (!texturecomposite[tex])
         R_GenerateComposite (tex);
+    else
+        Z_Touch (texturecomposite[tex]);
 
     return texturecomposite[tex] + ofs;
 }
@@ -911,6 +914,124 @@ int R_TextureNumForName (char* name)
 
 
 
+// Queue the patches of a texture
+static void R_PrefetchTexture (int texnum)
+{
+    texture_t*           texture;
+    int                  j;
+
+    texture = textures[texnum];
+
+    for (j=0 ; j<texture->patchcount ; j++)
+        W_PrefetchLump(texture->patches[j].patch);
+}
+
+//
+// R_PrefetchLevel
+// Queues the graphics R_PrecacheLevel will want for the level whose
+// map lumps start at lumpnum, to be read in the background.  Goes by
+// the map lumps rather than the level structures, so it can be run
+// before the level is set up.
+//
+void R_PrefetchLevel (int lumpnum)
+{
+    char*                spritepresent;
+
+    int                  i;
+    int                  j;
+    int                  k;
+    int                  count;
+    int                  texnum;
+    int                  lump;
+
+    mapsector_t*         ms;
+    mapsidedef_t*        msd;
+    mapthing_t*          mt;
+    spriteframe_t*       sf;
+
+    if (demoplayback)
+        return;
+
+    // Prefetch flats.
+    ms = W_CacheLumpNum(lumpnum+ML_SECTORS, PU_STATIC);
+    count = W_LumpLength(lumpnum+ML_SECTORS) / sizeof(mapsector_t);
+
+    for (i=0 ; i<count ; i++)
+    {
+        lump = W_CheckNumForName(ms[i].floorpic);
+        if (lump >= 0)
+            W_PrefetchLump(lump);
+
+        lump = W_CheckNumForName(ms[i].ceilingpic);
+        if (lump >= 0)
+            W_PrefetchLump(lump);
+    }
+
+    W_ReleaseLumpNum(lumpnum+ML_SECTORS);
+
+    // Prefetch textures, and the sky.
+    msd = W_CacheLumpNum(lumpnum+ML_SIDEDEFS, PU_STATIC);
+    count = W_LumpLength(lumpnum+ML_SIDEDEFS) / sizeof(mapsidedef_t);
+
+    for (i=0 ; i<count ; i++)
+    {
+        texnum = R_CheckTextureNumForName(msd[i].toptexture);
+        if (texnum >= 0)
+            R_PrefetchTexture(texnum);
+
+        texnum = R_CheckTextureNumForName(msd[i].midtexture);
+        if (texnum >= 0)
+            R_PrefetchTexture(texnum);
+
+        texnum = R_CheckTextureNumForName(msd[i].bottomtexture);
+        if (texnum >= 0)
+            R_PrefetchTexture(texnum);
+    }
+
+    W_ReleaseLumpNum(lumpnum+ML_SIDEDEFS);
+
+    R_PrefetchTexture(skytexture);
+
+    // Prefetch sprites of the things placed on the map, and the player.
+    spritepresent = Z_Malloc(numsprites, PU_STATIC, NULL);
+    memset (spritepresent,0, numsprites);
+
+    spritepresent[states[mobjinfo[MT_PLAYER].spawnstate].sprite] = 1;
+
+    mt = W_CacheLumpNum(lumpnum+ML_THINGS, PU_STATIC);
+    count = W_LumpLength(lumpnum+ML_THINGS) / sizeof(mapthing_t);
+
+    for (i=0 ; i<count ; i++)
+    {
+        for (j=0 ; j<NUMMOBJTYPES ; j++)
+        {
+            if (SHORT(mt[i].type) == mobjinfo[j].doomednum)
+            {
+                spritepresent[states[mobjinfo[j].spawnstate].sprite] = 1;
+                break;
+            }
+        }
+    }
+
+    W_ReleaseLumpNum(lumpnum+ML_THINGS);
+
+    for (i=0 ; i<numsprites ; i++)
+    {
+        if (!spritepresent[i])
+            continue;
+
+        for (j=0 ; j<sprites[i].numframes ; j++)
+        {
+            sf = &sprites[i].spriteframes[j];
+            for (k=0 ; k<8 ; k++)
+                W_PrefetchLump(firstspritelump + sf->lump[k]);
+        }
+    }
+
+    Z_Free(spritepresent);
+}
+
+
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
@@ -451,6 +451,9 @@ typedef struct
     int              lightlevel;
     int              minx;
     int              maxx;
+
+    // next visplane in the same hash chain, -1 for none
+    int              next;
   
     // leave pads for [minx-1]/[maxx+1]
     unsigned int     pad1;                  // CHANGED FOR HIRES
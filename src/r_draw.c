@@ -27,13 +27,16 @@
 //-----------------------------------------------------------------------------
 
 
+#include "c_io.h"
 #include "deh_main.h"
 #include "doomdef.h"
 
 // State.
 #include "doomstat.h"
 
+#include "i_swap.h"
 #include "i_system.h"
+#include "m_argv.h"
 #include "r_local.h"
 
 // Needs access to LFB (guess what).
@@ -46,7 +49,6 @@
 //
 // Spectre/Invisibility.
 //
-#define FUZZTABLE      50 
 #define FUZZOFF        (SCREENWIDTH)
 
 // ?
@@ -94,7 +96,7 @@ int                 fuzzoffset[FUZZTABLE] =
 
 int                 fuzzpos = 0; 
 
-// just for profiling 
+// columns and spans drawn this frame, for the render profile
 int                 dscount;
 int                 dccount;
 int                 viewwidth;
@@ -108,6 +110,7 @@ int                 dc_x;
 int                 dc_yl; 
 int                 dc_yh; 
 int                 dc_texheight;                 // Tutti-Frutti fix
+colslot_t           dc_slot = COL_OTHER;
 int                 ds_y; 
 int                 ds_x1; 
 int                 ds_x2;
@@ -122,7 +125,39 @@ fixed_t             ds_ystep;
 fixed_t             dc_iscale; 
 fixed_t             dc_texturemid;
 
-static const int linesize = SCREENWIDTH;
+// Steps from a pixel of the view to the one below it and to the one
+//  on its right.  With -columnmajor the view is drawn a column at a
+//  time into viewbuffer, and copied to the screen when it is done.
+static int linesize = SCREENWIDTH;
+static int pixelstep = 1;
+static byte *viewbuffer = NULL;
+
+// Base columns put off by R_BatchColumn, see R_DrawColumnQuadKernel,
+//  one queue for each wall tier.
+static drawcolumn_t quadcols[NUMCOLSLOTS][4];
+static int slotcols[NUMCOLSLOTS];
+static int numquadcols;         // in all the queues
+
+// Set by R_InitKernels when four pixels can be stored as one word.
+static boolean widestores = false;
+
+void (*drawspankernel) (drawspan_t *ds) = R_DrawSpanKernel;
+void (*drawspanlowkernel) (drawspan_t *ds) = R_DrawSpanLowKernel;
+
+// Four pixels in screen order as one word.
+#ifdef SYS_BIG_ENDIAN
+#define R_PackPixels(a, b, c, d)                                        \
+    (((uint32_t) (a) << 24) | ((uint32_t) (b) << 16)                    \
+   | ((uint32_t) (c) << 8) | (uint32_t) (d))
+#else
+#define R_PackPixels(a, b, c, d)                                        \
+    (((uint32_t) (d) << 24) | ((uint32_t) (c) << 16)                    \
+   | ((uint32_t) (b) << 8) | (uint32_t) (a))
+#endif
+
+// Offset of a span's texel in its 64x64 flat.
+#define R_SpanSpot(position)                                            \
+    ((((position) >> 4) & 0x0fc0) | ((position) >> 26))
  
 // Backing buffer containing the bezel drawn around the screen and 
 // surrounding background.
@@ -143,7 +178,7 @@ static byte *background_buffer = NULL;
 // 
 // replace R_DrawColumn() with Lee Killough's implementation
 // found in MBF to fix Tutti-Frutti, taken from mbfsrc/R_DRAW.C:99-1979
-void R_DrawColumn (void) 
+void R_DrawColumnKernel (drawcolumn_t *dc)
 { 
     int              count;
 
@@ -152,38 +187,38 @@ void R_DrawColumn (void)
 
     fixed_t          fracstep;
 
-    count = dc_yh - dc_yl + 1;
+    count = dc->yh - dc->yl + 1;
 
     // Zero length, column does not exceed a pixel.
     if (count <= 0)
         return;
 
 #ifdef RANGECHECK
-    if ((unsigned)dc_x >= SCREENWIDTH
-        || dc_yl < 0
-        || dc_yh >= SCREENHEIGHT)
-        I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+    if ((unsigned)dc->x >= SCREENWIDTH
+        || dc->yl < 0
+        || dc->yh >= SCREENHEIGHT)
+        I_Error ("R_DrawColumn: %i to %i at %i", dc->yl, dc->yh, dc->x);
 #endif
 
     // Framebuffer destination address.
     // Use ylookup LUT to avoid multiply with ScreenWidth.
     // Use columnofs LUT for subwindows?
-    dest = ylookup[dc_yl] + columnofs[dc_x];
+    dest = ylookup[dc->yl] + columnofs[dc->x];
 
     // Determine scaling, which is the only mapping to be done.
-    fracstep = dc_iscale;
-    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+    fracstep = dc->iscale;
+    frac = dc->texturemid + (dc->yl-centery)*fracstep;
 
     // Inner loop that does the actual texture mapping,
     //  e.g. a DDA-lile scaling.
     // This is as fast as it gets.
     // more performance tuning
-    register const byte *source = dc_source;
-    register const lighttable_t *colormap = dc_colormap;
-    register int heightmask = dc_texheight-1;
+    register const byte *source = dc->source;
+    register const lighttable_t *colormap = dc->colormap;
+    register int heightmask = dc->texheight-1;
 
     // not a power of 2
-    if (dc_texheight & heightmask)
+    if (dc->texheight & heightmask)
     {
         heightmask++;
         heightmask <<= FRACBITS;
@@ -284,7 +319,7 @@ void R_DrawColumn (void)
 #endif
 
 
-void R_DrawColumnLow (void) 
+void R_DrawColumnLowKernel (drawcolumn_t *dc)
 { 
     int                  count; 
     byte*                dest; 
@@ -295,45 +330,45 @@ void R_DrawColumnLow (void)
     fixed_t              fracstep;         
     int                  x;
  
-    count = dc_yh - dc_yl; 
+    count = dc->yh - dc->yl; 
 
     // Zero length.
     if (count < 0) 
         return; 
                                  
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-        || dc_yl < 0
-        || dc_yh >= SCREENHEIGHT)
+    if ((unsigned)dc->x >= SCREENWIDTH
+        || dc->yl < 0
+        || dc->yh >= SCREENHEIGHT)
     {
         
-        I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+        I_Error ("R_DrawColumn: %i to %i at %i", dc->yl, dc->yh, dc->x);
     }
     //        dccount++; 
 #endif 
     // Blocky mode, need to multiply by 2.
-    x = dc_x << 1;
+    x = dc->x << 1;
 
-    dest = ylookup[(dc_yl << hires)] + columnofs[x];        // CHANGED FOR HIRES
-    dest2 = ylookup[(dc_yl << hires)] + columnofs[x+1];     // CHANGED FOR HIRES
-    dest3 = ylookup[(dc_yl << hires) + 1] + columnofs[x];   // ADDED FOR HIRES
-    dest4 = ylookup[(dc_yl << hires) + 1] + columnofs[x+1]; // ADDED FOR HIRES
+    dest = ylookup[(dc->yl << hires)] + columnofs[x];        // CHANGED FOR HIRES
+    dest2 = ylookup[(dc->yl << hires)] + columnofs[x+1];     // CHANGED FOR HIRES
+    dest3 = ylookup[(dc->yl << hires) + 1] + columnofs[x];   // ADDED FOR HIRES
+    dest4 = ylookup[(dc->yl << hires) + 1] + columnofs[x+1]; // ADDED FOR HIRES
 
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+    fracstep = dc->iscale; 
+    frac = dc->texturemid + (dc->yl-centery)*fracstep;
     
     do 
     {
         // Hack. Does not work corretly.
-        *dest2 = *dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
+        *dest2 = *dest = dc->colormap[dc->source[(frac>>FRACBITS)&127]];
 
-        dest += SCREENWIDTH << hires;                       // CHANGED FOR HIRES
-        dest2 += SCREENWIDTH << hires;                      // CHANGED FOR HIRES
+        dest += linesize << hires;                       // CHANGED FOR HIRES
+        dest2 += linesize << hires;                      // CHANGED FOR HIRES
         if (hires)                                          // ADDED FOR HIRES
         {                                                   // ADDED FOR HIRES
-            *dest4 = *dest3 = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
-            dest3 += SCREENWIDTH << hires;                  // ADDED FOR HIRES
-            dest4 += SCREENWIDTH << hires;                  // ADDED FOR HIRES
+            *dest4 = *dest3 = dc->colormap[dc->source[(frac>>FRACBITS)&127]];
+            dest3 += linesize << hires;                  // ADDED FOR HIRES
+            dest4 += linesize << hires;                  // ADDED FOR HIRES
         }                                                   // ADDED FOR HIRES
 
         frac += fracstep; 
@@ -350,7 +385,7 @@ void R_DrawColumnLow (void)
 //  could create the SHADOW effect,
 //  i.e. spectres and invisible players.
 //
-void R_DrawFuzzColumn (void) 
+void R_DrawFuzzColumnKernel (drawcolumn_t *dc)
 { 
     int                  count; 
     byte*                dest; 
@@ -358,33 +393,33 @@ void R_DrawFuzzColumn (void)
     fixed_t              fracstep;         
 
     // Adjust borders. Low... 
-    if (!dc_yl) 
-        dc_yl = 1;
+    if (!dc->yl) 
+        dc->yl = 1;
 
     // .. and high.
-    if (dc_yh == viewheight-1) 
-        dc_yh = viewheight - 2; 
+    if (dc->yh == viewheight-1) 
+        dc->yh = viewheight - 2; 
                  
-    count = dc_yh - dc_yl; 
+    count = dc->yh - dc->yl; 
 
     // Zero length.
     if (count < 0) 
         return; 
 
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-        || dc_yl < 0 || dc_yh >= SCREENHEIGHT)
+    if ((unsigned)dc->x >= SCREENWIDTH
+        || dc->yl < 0 || dc->yh >= SCREENHEIGHT)
     {
         I_Error ("R_DrawFuzzColumn: %i to %i at %i",
-                 dc_yl, dc_yh, dc_x);
+                 dc->yl, dc->yh, dc->x);
     }
 #endif
     
-    dest = ylookup[dc_yl] + columnofs[dc_x];
+    dest = ylookup[dc->yl] + columnofs[dc->x];
 
     // Looks familiar.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+    fracstep = dc->iscale; 
+    frac = dc->texturemid + (dc->yl-centery)*fracstep; 
 
     // Looks like an attempt at dithering,
     //  using the colormap #6 (of 0-31, a bit
@@ -395,13 +430,13 @@ void R_DrawFuzzColumn (void)
         //  a pixel that is either one column
         //  left or right of the current one.
         // Add index from colormap to index.
-        *dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]]; 
+        *dest = colormaps[6*256+dest[fuzzoffset[dc->fuzzpos]]]; 
 
         // Clamp table lookup index.
-        if (++fuzzpos == FUZZTABLE) 
-            fuzzpos = 0;
+        if (++dc->fuzzpos == FUZZTABLE) 
+            dc->fuzzpos = 0;
         
-        dest += SCREENWIDTH;
+        dest += linesize;
 
         frac += fracstep; 
     } while (count--); 
@@ -409,7 +444,7 @@ void R_DrawFuzzColumn (void)
 
 // low detail mode version
  
-void R_DrawFuzzColumnLow (void) 
+void R_DrawFuzzColumnLowKernel (drawcolumn_t *dc)
 { 
     int                  count; 
     byte*                dest; 
@@ -421,14 +456,14 @@ void R_DrawFuzzColumnLow (void)
     int                  x;
 
     // Adjust borders. Low... 
-    if (!dc_yl) 
-        dc_yl = 1;
+    if (!dc->yl) 
+        dc->yl = 1;
 
     // .. and high.
-    if (dc_yh == viewheight-1) 
-        dc_yh = viewheight - 2; 
+    if (dc->yh == viewheight-1) 
+        dc->yh = viewheight - 2; 
                  
-    count = dc_yh - dc_yl; 
+    count = dc->yh - dc->yl; 
 
     // Zero length.
     if (count < 0) 
@@ -436,25 +471,25 @@ void R_DrawFuzzColumnLow (void)
 
     // low detail mode, need to multiply by 2
     
-    x = dc_x << 1;
+    x = dc->x << 1;
     
 #ifdef RANGECHECK 
     if ((unsigned)x >= SCREENWIDTH
-        || dc_yl < 0 || dc_yh >= SCREENHEIGHT)
+        || dc->yl < 0 || dc->yh >= SCREENHEIGHT)
     {
         I_Error ("R_DrawFuzzColumn: %i to %i at %i",
-                 dc_yl, dc_yh, dc_x);
+                 dc->yl, dc->yh, dc->x);
     }
 #endif
 
-    dest = ylookup[(dc_yl << hires)] + columnofs[x];        // CHANGED FOR HIRES
-    dest2 = ylookup[(dc_yl << hires)] + columnofs[x+1];     // CHANGED FOR HIRES
-    dest3 = ylookup[(dc_yl << hires) + 1] + columnofs[x];   // ADDED FOR HIRES
-    dest4 = ylookup[(dc_yl << hires) + 1] + columnofs[x+1]; // ADDED FOR HIRES
+    dest = ylookup[(dc->yl << hires)] + columnofs[x];        // CHANGED FOR HIRES
+    dest2 = ylookup[(dc->yl << hires)] + columnofs[x+1];     // CHANGED FOR HIRES
+    dest3 = ylookup[(dc->yl << hires) + 1] + columnofs[x];   // ADDED FOR HIRES
+    dest4 = ylookup[(dc->yl << hires) + 1] + columnofs[x+1]; // ADDED FOR HIRES
 
     // Looks familiar.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+    fracstep = dc->iscale; 
+    frac = dc->texturemid + (dc->yl-centery)*fracstep; 
 
     // Looks like an attempt at dithering,
     //  using the colormap #6 (of 0-31, a bit
@@ -465,22 +500,22 @@ void R_DrawFuzzColumnLow (void)
         //  a pixel that is either one column
         //  left or right of the current one.
         // Add index from colormap to index.
-        *dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]]; 
-        *dest2 = colormaps[6*256+dest2[fuzzoffset[fuzzpos]]]; 
+        *dest = colormaps[6*256+dest[fuzzoffset[dc->fuzzpos]]]; 
+        *dest2 = colormaps[6*256+dest2[fuzzoffset[dc->fuzzpos]]]; 
         if (hires)                                          // ADDED FOR HIRES
         {                                                   // ADDED FOR HIRES
-            *dest3 = colormaps[6*256+dest[fuzzoffset[fuzzpos]]];
-            *dest4 = colormaps[6*256+dest2[fuzzoffset[fuzzpos]]];
-            dest3 += SCREENWIDTH << hires;                  // ADDED FOR HIRES
-            dest4 += SCREENWIDTH << hires;                  // ADDED FOR HIRES
+            *dest3 = colormaps[6*256+dest[fuzzoffset[dc->fuzzpos]]];
+            *dest4 = colormaps[6*256+dest2[fuzzoffset[dc->fuzzpos]]];
+            dest3 += linesize << hires;                  // ADDED FOR HIRES
+            dest4 += linesize << hires;                  // ADDED FOR HIRES
         }
 
         // Clamp table lookup index.
-        if (++fuzzpos == FUZZTABLE) 
-            fuzzpos = 0;
+        if (++dc->fuzzpos == FUZZTABLE) 
+            dc->fuzzpos = 0;
 
-        dest += SCREENWIDTH << hires;                       // CHANGED FOR HIRES
-        dest2 += SCREENWIDTH << hires;                      // CHANGED FOR HIRES
+        dest += linesize << hires;                       // CHANGED FOR HIRES
+        dest2 += linesize << hires;                      // CHANGED FOR HIRES
 
         frac += fracstep; 
     } while (count--); 
@@ -499,34 +534,34 @@ void R_DrawFuzzColumnLow (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-void R_DrawTranslatedColumn (void) 
+void R_DrawTranslatedColumnKernel (drawcolumn_t *dc)
 { 
     int                  count; 
     byte*                dest; 
     fixed_t              frac;
     fixed_t              fracstep;         
  
-    count = dc_yh - dc_yl; 
+    count = dc->yh - dc->yl; 
     if (count < 0) 
         return; 
                                  
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-        || dc_yl < 0
-        || dc_yh >= SCREENHEIGHT)
+    if ((unsigned)dc->x >= SCREENWIDTH
+        || dc->yl < 0
+        || dc->yh >= SCREENHEIGHT)
     {
         I_Error ( "R_DrawColumn: %i to %i at %i",
-                  dc_yl, dc_yh, dc_x);
+                  dc->yl, dc->yh, dc->x);
     }
     
 #endif 
 
 
-    dest = ylookup[dc_yl] + columnofs[dc_x]; 
+    dest = ylookup[dc->yl] + columnofs[dc->x]; 
 
     // Looks familiar.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+    fracstep = dc->iscale; 
+    frac = dc->texturemid + (dc->yl-centery)*fracstep; 
 
     // Here we do an additional index re-mapping.
     do 
@@ -536,14 +571,14 @@ void R_DrawTranslatedColumn (void)
         //  used with PLAY sprites.
         // Thus the "green" ramp of the player 0 sprite
         //  is mapped to gray, red, black/indigo. 
-        *dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-        dest += SCREENWIDTH;
+        *dest = dc->colormap[dc->translation[dc->source[frac>>FRACBITS]]];
+        dest += linesize;
         
         frac += fracstep; 
     } while (count--); 
 } 
 
-void R_DrawTranslatedColumnLow (void) 
+void R_DrawTranslatedColumnLowKernel (drawcolumn_t *dc)
 { 
     int                  count; 
     byte*                dest; 
@@ -554,32 +589,32 @@ void R_DrawTranslatedColumnLow (void)
     fixed_t              fracstep;         
     int                  x;
  
-    count = dc_yh - dc_yl; 
+    count = dc->yh - dc->yl; 
     if (count < 0) 
         return; 
 
     // low detail, need to scale by 2
-    x = dc_x << 1;
+    x = dc->x << 1;
                                  
 #ifdef RANGECHECK 
     if ((unsigned)x >= SCREENWIDTH
-        || dc_yl < 0
-        || dc_yh >= SCREENHEIGHT)
+        || dc->yl < 0
+        || dc->yh >= SCREENHEIGHT)
     {
         I_Error ( "R_DrawColumn: %i to %i at %i",
-                  dc_yl, dc_yh, x);
+                  dc->yl, dc->yh, x);
     }
     
 #endif 
 
-    dest = ylookup[(dc_yl << hires)] + columnofs[x];        // CHANGED FOR HIRES
-    dest2 = ylookup[(dc_yl << hires)] + columnofs[x+1];     // CHANGED FOR HIRES
-    dest3 = ylookup[(dc_yl << hires) + 1] + columnofs[x];   // ADDED FOR HIRES
-    dest4 = ylookup[(dc_yl << hires) + 1] + columnofs[x+1]; // ADDED FOR HIRES
+    dest = ylookup[(dc->yl << hires)] + columnofs[x];        // CHANGED FOR HIRES
+    dest2 = ylookup[(dc->yl << hires)] + columnofs[x+1];     // CHANGED FOR HIRES
+    dest3 = ylookup[(dc->yl << hires) + 1] + columnofs[x];   // ADDED FOR HIRES
+    dest4 = ylookup[(dc->yl << hires) + 1] + columnofs[x+1]; // ADDED FOR HIRES
 
     // Looks familiar.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+    fracstep = dc->iscale; 
+    frac = dc->texturemid + (dc->yl-centery)*fracstep; 
 
     // Here we do an additional index re-mapping.
     do 
@@ -589,17 +624,17 @@ void R_DrawTranslatedColumnLow (void)
         //  used with PLAY sprites.
         // Thus the "green" ramp of the player 0 sprite
         //  is mapped to gray, red, black/indigo. 
-        *dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-        *dest2 = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
+        *dest = dc->colormap[dc->translation[dc->source[frac>>FRACBITS]]];
+        *dest2 = dc->colormap[dc->translation[dc->source[frac>>FRACBITS]]];
 
-        dest += SCREENWIDTH << hires;  // CHANGED FOR HIRES
-        dest2 += SCREENWIDTH << hires; // CHANGED FOR HIRES
+        dest += linesize << hires;  // CHANGED FOR HIRES
+        dest2 += linesize << hires; // CHANGED FOR HIRES
         if (hires)                     // ADDED FOR HIRES
         {                              // ADDED FOR HIRES
-            *dest3 = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-            *dest4 = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-            dest3 += SCREENWIDTH << hires; // ADDED FOR HIRES
-            dest4 += SCREENWIDTH << hires; // ADDED FOR HIRES
+            *dest3 = dc->colormap[dc->translation[dc->source[frac>>FRACBITS]]];
+            *dest4 = dc->colormap[dc->translation[dc->source[frac>>FRACBITS]]];
+            dest3 += linesize << hires; // ADDED FOR HIRES
+            dest4 += linesize << hires; // ADDED FOR HIRES
         }                                  // ADDED FOR HIRES
         
         frac += fracstep; 
@@ -609,6 +644,300 @@ void R_DrawTranslatedColumnLow (void)
 
 
 
+//
+// R_SaveColumn
+// Takes a copy of the dc_* globals, for a column to be drawn now or
+//  later by one of the kernels above.
+//
+void R_SaveColumn (drawcolumn_t *dc)
+{
+    dc->x = dc_x;
+    dc->yl = dc_yl;
+    dc->yh = dc_yh;
+    dc->texheight = dc_texheight;
+    dc->iscale = dc_iscale;
+    dc->texturemid = dc_texturemid;
+    dc->source = dc_source;
+    dc->colormap = dc_colormap;
+    dc->translation = dc_translation;
+    dc->fuzzpos = fuzzpos;
+
+    dccount++;
+}
+
+void R_DrawColumn (void)
+{
+    drawcolumn_t dc;
+
+    R_SaveColumn (&dc);
+    R_DrawColumnKernel (&dc);
+}
+
+void R_DrawColumnLow (void)
+{
+    drawcolumn_t dc;
+
+    R_SaveColumn (&dc);
+    R_DrawColumnLowKernel (&dc);
+}
+
+void R_DrawFuzzColumn (void)
+{
+    drawcolumn_t dc;
+
+    if (numquadcols)
+        R_FlushColumns ();
+
+    R_SaveColumn (&dc);
+    R_DrawFuzzColumnKernel (&dc);
+    fuzzpos = dc.fuzzpos;
+}
+
+void R_DrawFuzzColumnLow (void)
+{
+    drawcolumn_t dc;
+
+    R_SaveColumn (&dc);
+    R_DrawFuzzColumnLowKernel (&dc);
+    fuzzpos = dc.fuzzpos;
+}
+
+void R_DrawTranslatedColumn (void)
+{
+    drawcolumn_t dc;
+
+    if (numquadcols)
+        R_FlushColumns ();
+
+    R_SaveColumn (&dc);
+    R_DrawTranslatedColumnKernel (&dc);
+}
+
+void R_DrawTranslatedColumnLow (void)
+{
+    drawcolumn_t dc;
+
+    R_SaveColumn (&dc);
+    R_DrawTranslatedColumnLowKernel (&dc);
+}
+
+
+//
+// Quad columns.
+// Base columns at adjacent x are put off until there are four of
+//  them, then drawn a row of four pixels at a time where they overlap,
+//  writing neighbouring bytes instead of one byte per row.  Any other
+//  draw, and the end of the view, first draws the ones put off.
+// The seg loop draws the top, middle and bottom of a wall at one x
+//  before going on to the next, so each tier has a queue of its own.
+//  Wall columns never cover each other, so the tiers can be drawn in
+//  any order, but nothing else is put off along with them.
+//
+typedef struct
+{
+    byte*               dest;
+    const byte*         source;
+    const lighttable_t* colormap;
+    fixed_t             frac;
+    fixed_t             fracstep;
+    int                 heightmask;
+    boolean             wrap;           // not a power of 2
+} quadcolumn_t;
+
+// One texel, stepped as in R_DrawColumnKernel.
+static inline byte R_QuadTexel (quadcolumn_t *c)
+{
+    byte pixel;
+
+    if (c->wrap)
+    {
+        pixel = c->colormap[c->source[c->frac>>FRACBITS]];
+
+        if ((c->frac += c->fracstep) >= c->heightmask)
+            c->frac -= c->heightmask;
+    }
+    else
+    {
+        pixel = c->colormap[c->source[(c->frac>>FRACBITS) & c->heightmask]];
+        c->frac += c->fracstep;
+    }
+
+    return pixel;
+}
+
+static inline void R_QuadPixel (quadcolumn_t *c)
+{
+    *c->dest = R_QuadTexel (c);
+    c->dest += linesize;
+}
+
+void R_DrawColumnQuadKernel (drawcolumn_t *dc)
+{
+    quadcolumn_t        col[4];
+    quadcolumn_t*       c;
+    int                 top;
+    int                 bottom;
+    int                 i;
+    int                 y;
+
+    top = dc[0].yl;
+    bottom = dc[0].yh;
+
+    for (i=1 ; i<4 ; i++)
+    {
+        if (dc[i].yl > top)
+            top = dc[i].yl;
+
+        if (dc[i].yh < bottom)
+            bottom = dc[i].yh;
+    }
+
+    // Ragged, or a column is empty: no rows in common.
+    if (top > bottom)
+    {
+        for (i=0 ; i<4 ; i++)
+            R_DrawColumnKernel (&dc[i]);
+
+        return;
+    }
+
+    for (i=0, c=col ; i<4 ; i++, c++)
+    {
+#ifdef RANGECHECK
+        if ((unsigned)dc[i].x >= SCREENWIDTH
+            || dc[i].yl < 0
+            || dc[i].yh >= SCREENHEIGHT)
+            I_Error ("R_DrawColumn: %i to %i at %i",
+                     dc[i].yl, dc[i].yh, dc[i].x);
+#endif
+
+        c->dest = ylookup[dc[i].yl] + columnofs[dc[i].x];
+        c->source = dc[i].source;
+        c->colormap = dc[i].colormap;
+        c->fracstep = dc[i].iscale;
+        c->frac = dc[i].texturemid + (dc[i].yl-centery)*c->fracstep;
+        c->heightmask = dc[i].texheight-1;
+        c->wrap = (dc[i].texheight & c->heightmask) != 0;
+
+        if (c->wrap)
+        {
+            c->heightmask++;
+            c->heightmask <<= FRACBITS;
+
+            if (c->frac < 0)
+                while ((c->frac += c->heightmask) < 0);
+            else
+                while (c->frac >= c->heightmask)
+                    c->frac -= c->heightmask;
+        }
+
+        // rows above the shared ones
+        for (y=dc[i].yl ; y<top ; y++)
+            R_QuadPixel (c);
+    }
+
+    if (widestores && !((uintptr_t) col[0].dest & 3))
+    {
+        byte*           dest = col[0].dest;
+        byte            p0, p1, p2, p3;
+
+        for (y=top ; y<=bottom ; y++)
+        {
+            p0 = R_QuadTexel (&col[0]);
+            p1 = R_QuadTexel (&col[1]);
+            p2 = R_QuadTexel (&col[2]);
+            p3 = R_QuadTexel (&col[3]);
+            *(uint32_t *) dest = R_PackPixels (p0, p1, p2, p3);
+            dest += linesize;
+        }
+
+        for (i=0 ; i<4 ; i++)
+            col[i].dest = dest + i;
+    }
+    else
+    {
+        for (y=top ; y<=bottom ; y++)
+        {
+            R_QuadPixel (&col[0]);
+            R_QuadPixel (&col[1]);
+            R_QuadPixel (&col[2]);
+            R_QuadPixel (&col[3]);
+        }
+    }
+
+    // rows below
+    for (i=0, c=col ; i<4 ; i++, c++)
+        for (y=bottom+1 ; y<=dc[i].yh ; y++)
+            R_QuadPixel (c);
+}
+
+//
+// R_FlushSlot
+// Draws the base columns put off in one queue.
+//
+static void R_FlushSlot (colslot_t slot)
+{
+    int                 i;
+
+    if (slotcols[slot] == 4)
+    {
+        R_DrawColumnQuadKernel (quadcols[slot]);
+    }
+    else
+    {
+        for (i=0 ; i<slotcols[slot] ; i++)
+            R_DrawColumnKernel (&quadcols[slot][i]);
+    }
+
+    numquadcols -= slotcols[slot];
+    slotcols[slot] = 0;
+}
+
+//
+// R_FlushColumns
+// Draws the base columns put off by R_BatchColumn.
+//
+void R_FlushColumns (void)
+{
+    int                 i;
+
+    for (i=0 ; i<NUMCOLSLOTS && numquadcols ; i++)
+    {
+        if (slotcols[i])
+            R_FlushSlot (i);
+    }
+}
+
+//
+// R_BatchColumn
+// Used for colfunc in high detail, in place of R_DrawColumn.
+// Puts the column off in the queue for dc_slot.
+//
+void R_BatchColumn (void)
+{
+    drawcolumn_t*       cols;
+    colslot_t           slot;
+
+    slot = dc_slot;
+    cols = quadcols[slot];
+
+    // anything but a wall may cover the walls put off, and the
+    // other way round, so the two are never put off together
+    if (slot == COL_OTHER ? numquadcols != slotcols[COL_OTHER]
+                          : slotcols[COL_OTHER] != 0)
+        R_FlushColumns ();
+
+    if (slotcols[slot] && dc_x != cols[slotcols[slot]-1].x + 1)
+        R_FlushSlot (slot);
+
+    R_SaveColumn (&cols[slotcols[slot]++]);
+    numquadcols++;
+
+    if (slotcols[slot] == 4)
+        R_FlushSlot (slot);
+}
+
+
 //
 // R_InitTranslationTables
 // Creates the translation tables to map
@@ -656,7 +985,7 @@ void R_InitTranslationTables (void)
 //
 //
 // Draws the actual span.
-void R_DrawSpan (void) 
+void R_DrawSpanKernel (drawspan_t *ds)
 { 
     unsigned int position, step;
     byte *dest;
@@ -665,31 +994,24 @@ void R_DrawSpan (void)
     unsigned int xtemp, ytemp;
 
 #ifdef RANGECHECK
-    if (ds_x2 < ds_x1
-        || ds_x1<0
-        || ds_x2>=SCREENWIDTH
-        || (unsigned)ds_y>SCREENHEIGHT)
+    if (ds->x2 < ds->x1
+        || ds->x1<0
+        || ds->x2>=SCREENWIDTH
+        || (unsigned)ds->y>SCREENHEIGHT)
     {
         I_Error( "R_DrawSpan: %i to %i at %i",
-                 ds_x1,ds_x2,ds_y);
+                 ds->x1,ds->x2,ds->y);
     }
 //        dscount++;
 #endif
 
-    // Pack position and step variables into a single 32-bit integer,
-    // with x in the top 16 bits and y in the bottom 16 bits.  For
-    // each 16-bit part, the top 6 bits are the integer part and the
-    // bottom 10 bits are the fractional part of the pixel position.
-
-    position = ((ds_xfrac << 10) & 0xffff0000)
-             | ((ds_yfrac >> 6)  & 0x0000ffff);
-    step = ((ds_xstep << 10) & 0xffff0000)
-         | ((ds_ystep >> 6)  & 0x0000ffff);
+    position = ds->position;
+    step = ds->step;
 
-    dest = ylookup[ds_y] + columnofs[ds_x1];
+    dest = ylookup[ds->y] + columnofs[ds->x1];
 
     // We do not check for zero spans here?
-    count = ds_x2 - ds_x1;
+    count = ds->x2 - ds->x1;
 
     do
     {
@@ -700,7 +1022,8 @@ void R_DrawSpan (void)
 
         // Lookup pixel from flat texture tile,
         //  re-index using light/colormap.
-        *dest++ = ds_colormap[ds_source[spot]];
+        *dest = ds->colormap[ds->source[spot]];
+        dest += pixelstep;
 
         position += step;
 
@@ -785,7 +1108,7 @@ void R_DrawSpan (void)
 //
 // Again..
 //
-void R_DrawSpanLow (void)
+void R_DrawSpanLowKernel (drawspan_t *ds)
 {
     unsigned int position, step;
     unsigned int xtemp, ytemp;
@@ -796,29 +1119,24 @@ void R_DrawSpanLow (void)
     int spot;
 
 #ifdef RANGECHECK
-    if (ds_x2 < ds_x1
-        || ds_x1<0
-        || ds_x2>=SCREENWIDTH
-        || (unsigned)ds_y>SCREENHEIGHT)
+    if (ds->x2 < ds->x1
+        || ds->x1<0
+        || ds->x2>=SCREENWIDTH
+        || (unsigned)ds->y>SCREENHEIGHT)
     {
         I_Error( "R_DrawSpan: %i to %i at %i",
-                 ds_x1,ds_x2,ds_y);
+                 ds->x1,ds->x2,ds->y);
     }
 #endif
 
-    position = ((ds_xfrac << 10) & 0xffff0000)
-             | ((ds_yfrac >> 6)  & 0x0000ffff);
-    step = ((ds_xstep << 10) & 0xffff0000)
-         | ((ds_ystep >> 6)  & 0x0000ffff);
+    position = ds->position;
+    step = ds->step;
 
-    count = (ds_x2 - ds_x1);
+    count = (ds->x2 - ds->x1);
 
     // Blocky mode, need to multiply by 2.
-    ds_x1 <<= 1;
-    ds_x2 <<= 1;
-
-    dest = ylookup[(ds_y << hires)] + columnofs[ds_x1];      // CHANGED FOR HIRES
-    dest2 = ylookup[(ds_y << hires) + 1] + columnofs[ds_x1]; // ADDED FOR HIRES
+    dest = ylookup[(ds->y << hires)] + columnofs[ds->x1 << 1];      // CHANGED FOR HIRES
+    dest2 = ylookup[(ds->y << hires) + 1] + columnofs[ds->x1 << 1]; // ADDED FOR HIRES
 
     do
     {
@@ -829,12 +1147,14 @@ void R_DrawSpanLow (void)
 
         // Lowres/blocky mode does it twice,
         //  while scale is adjusted appropriately.
-        *dest++ = ds_colormap[ds_source[spot]];
-        *dest++ = ds_colormap[ds_source[spot]];
+        dest[0] = ds->colormap[ds->source[spot]];
+        dest[pixelstep] = ds->colormap[ds->source[spot]];
+        dest += pixelstep << 1;
         if (hires)                                           // ADDED FOR HIRES
         {                                                    // ADDED FOR HIRES
-            *dest2++ = ds_colormap[ds_source[spot]];         // ADDED FOR HIRES
-            *dest2++ = ds_colormap[ds_source[spot]];         // ADDED FOR HIRES
+            dest2[0] = ds->colormap[ds->source[spot]];         // ADDED FOR HIRES
+            dest2[pixelstep] = ds->colormap[ds->source[spot]]; // ADDED FOR HIRES
+            dest2 += pixelstep << 1;                         // ADDED FOR HIRES
         }                                                    // ADDED FOR HIRES
 
         position += step;
@@ -842,6 +1162,200 @@ void R_DrawSpanLow (void)
     } while (count--);
 }
 
+//
+// R_DrawSpanWideKernel
+// As R_DrawSpanKernel, but once the destination is word aligned,
+//  four pixels are looked up and stored as one word.
+//
+void R_DrawSpanWideKernel (drawspan_t *ds)
+{
+    unsigned int position, step;
+    const byte *source;
+    const lighttable_t *colormap;
+    byte *dest;
+    byte p0, p1, p2, p3;
+    int count;
+
+#ifdef RANGECHECK
+    if (ds->x2 < ds->x1
+        || ds->x1<0
+        || ds->x2>=SCREENWIDTH
+        || (unsigned)ds->y>SCREENHEIGHT)
+    {
+        I_Error( "R_DrawSpan: %i to %i at %i",
+                 ds->x1,ds->x2,ds->y);
+    }
+#endif
+
+    position = ds->position;
+    step = ds->step;
+    source = ds->source;
+    colormap = ds->colormap;
+
+    dest = ylookup[ds->y] + columnofs[ds->x1];
+    count = ds->x2 - ds->x1 + 1;
+
+    while (count > 0 && ((uintptr_t) dest & 3))
+    {
+        *dest++ = colormap[source[R_SpanSpot(position)]];
+        position += step;
+        count--;
+    }
+
+    while (count >= 4)
+    {
+        p0 = colormap[source[R_SpanSpot(position)]];
+        position += step;
+        p1 = colormap[source[R_SpanSpot(position)]];
+        position += step;
+        p2 = colormap[source[R_SpanSpot(position)]];
+        position += step;
+        p3 = colormap[source[R_SpanSpot(position)]];
+        position += step;
+
+        *(uint32_t *) dest = R_PackPixels (p0, p1, p2, p3);
+        dest += 4;
+        count -= 4;
+    }
+
+    while (count > 0)
+    {
+        *dest++ = colormap[source[R_SpanSpot(position)]];
+        position += step;
+        count--;
+    }
+}
+
+//
+// R_DrawSpanLowWideKernel
+// As R_DrawSpanLowKernel, storing two doubled texels as one word.
+//
+void R_DrawSpanLowWideKernel (drawspan_t *ds)
+{
+    unsigned int position, step;
+    const byte *source;
+    const lighttable_t *colormap;
+    byte *dest, *dest2;                 // CHANGED FOR HIRES
+    byte p0, p1;
+    uint32_t word;
+    int count;
+
+#ifdef RANGECHECK
+    if (ds->x2 < ds->x1
+        || ds->x1<0
+        || ds->x2>=SCREENWIDTH
+        || (unsigned)ds->y>SCREENHEIGHT)
+    {
+        I_Error( "R_DrawSpan: %i to %i at %i",
+                 ds->x1,ds->x2,ds->y);
+    }
+#endif
+
+    position = ds->position;
+    step = ds->step;
+    source = ds->source;
+    colormap = ds->colormap;
+
+    count = ds->x2 - ds->x1 + 1;
+
+    // Blocky mode, need to multiply by 2.
+    dest = ylookup[(ds->y << hires)] + columnofs[ds->x1 << 1];      // CHANGED FOR HIRES
+    dest2 = ylookup[(ds->y << hires) + 1] + columnofs[ds->x1 << 1]; // ADDED FOR HIRES
+
+    // Texels are two pixels wide, so only an even start can get to
+    //  a word boundary, with at most one texel.
+    if ((uintptr_t) dest & 1)
+    {
+        R_DrawSpanLowKernel (ds);
+        return;
+    }
+
+    if (count > 0 && ((uintptr_t) dest & 3))
+    {
+        p0 = colormap[source[R_SpanSpot(position)]];
+        position += step;
+        dest[0] = dest[1] = p0;
+        dest += 2;
+        if (hires)                                           // ADDED FOR HIRES
+        {                                                    // ADDED FOR HIRES
+            dest2[0] = dest2[1] = p0;                        // ADDED FOR HIRES
+            dest2 += 2;                                      // ADDED FOR HIRES
+        }                                                    // ADDED FOR HIRES
+        count--;
+    }
+
+    while (count >= 2)
+    {
+        p0 = colormap[source[R_SpanSpot(position)]];
+        position += step;
+        p1 = colormap[source[R_SpanSpot(position)]];
+        position += step;
+
+        word = R_PackPixels (p0, p0, p1, p1);
+        *(uint32_t *) dest = word;
+        dest += 4;
+        if (hires)                                           // ADDED FOR HIRES
+        {                                                    // ADDED FOR HIRES
+            *(uint32_t *) dest2 = word;                      // ADDED FOR HIRES
+            dest2 += 4;                                      // ADDED FOR HIRES
+        }                                                    // ADDED FOR HIRES
+        count -= 2;
+    }
+
+    if (count > 0)
+    {
+        p0 = colormap[source[R_SpanSpot(position)]];
+        dest[0] = dest[1] = p0;
+        if (hires)                                           // ADDED FOR HIRES
+            dest2[0] = dest2[1] = p0;                        // ADDED FOR HIRES
+    }
+}
+
+//
+// R_SaveSpan
+// Takes a copy of the ds_* globals.
+//
+void R_SaveSpan (drawspan_t *ds)
+{
+    ds->y = ds_y;
+    ds->x1 = ds_x1;
+    ds->x2 = ds_x2;
+
+    // Pack position and step variables into a single 32-bit integer,
+    // with x in the top 16 bits and y in the bottom 16 bits.  For
+    // each 16-bit part, the top 6 bits are the integer part and the
+    // bottom 10 bits are the fractional part of the pixel position.
+
+    ds->position = ((ds_xfrac << 10) & 0xffff0000)
+                 | ((ds_yfrac >> 6)  & 0x0000ffff);
+    ds->step = ((ds_xstep << 10) & 0xffff0000)
+             | ((ds_ystep >> 6)  & 0x0000ffff);
+
+    ds->source = ds_source;
+    ds->colormap = ds_colormap;
+
+    dscount++;
+}
+
+void R_DrawSpan (void)
+{
+    drawspan_t ds;
+
+    if (numquadcols)
+        R_FlushColumns ();
+
+    R_SaveSpan (&ds);
+    drawspankernel (&ds);
+}
+
+void R_DrawSpanLow (void)
+{
+    drawspan_t ds;
+
+    R_SaveSpan (&ds);
+    drawspanlowkernel (&ds);
+}
+
 //
 // R_InitBuffer 
 // Creats lookup tables that avoid
@@ -874,7 +1388,288 @@ R_InitBuffer
     // Preclaculate all row offsets.
     for (i=0 ; i<height ; i++) 
         ylookup[i] = I_VideoBuffer + (i+viewwindowy)*SCREENWIDTH; 
+
+    // Column major view: columns of SCREENHEIGHT pixels.
+    if (viewbuffer)
+    {
+        for (i=0 ; i<width ; i++)
+            columnofs[i] = i * SCREENHEIGHT;
+
+        for (i=0 ; i<height ; i++)
+            ylookup[i] = viewbuffer + i;
+    }
 } 
+
+
+//
+// R_InitViewBuffer
+// Sets up the column major view buffer if -columnmajor was given.
+//
+void R_InitViewBuffer (void)
+{
+    int                i;
+
+    //!
+    // @category video
+    //
+    // Draw the 3D view a column at a time into a buffer of its own,
+    // so that walls and sprites are written to consecutive bytes,
+    // and copy it to the screen once the view is done.
+    //
+
+    if (!M_CheckParm ("-columnmajor"))
+        return;
+
+    viewbuffer = Z_Malloc (SCREENWIDTH*SCREENHEIGHT, PU_STATIC, NULL);
+    linesize = 1;
+    pixelstep = SCREENHEIGHT;
+
+    // the fuzz effect reads the pixels above and below
+    for (i=0 ; i<FUZZTABLE ; i++)
+        fuzzoffset[i] = fuzzoffset[i] > 0 ? linesize : -linesize;
+}
+
+
+//
+// R_TestKernels
+// Draws random spans and columns with the word-store kernels and with
+//  the byte at a time ones, into buffers of their own, and stops if
+//  a single byte differs.  Start and end columns are random, so the
+//  unaligned and odd start paths are covered as well.
+//
+
+#define KERNELTESTS     4096
+
+static unsigned int     kernelseed;
+
+static int R_KernelRandom (int range)
+{
+    kernelseed = kernelseed * 1103515245 + 12345;
+
+    return (kernelseed >> 8) % range;
+}
+
+static void R_KernelTestBuffer (byte *buffer)
+{
+    int                 i;
+
+    for (i=0 ; i<SCREENHEIGHT ; i++)
+        ylookup[i] = buffer + i*SCREENWIDTH;
+}
+
+static void R_KernelTestCompare (byte *ref, byte *test, char *name, int n)
+{
+    if (memcmp (ref, test, SCREENWIDTH*SCREENHEIGHT))
+        I_Error ("R_TestKernels: %s differs from the byte drawer (test %i)",
+                 name, n);
+}
+
+static void R_TestKernels (void)
+{
+    static const int    texheights[] = { 128, 64, 100, 72, 16 };
+    byte*               ref;
+    byte*               test;
+    byte*               source;
+    byte*               colormap;
+    drawspan_t          ds;
+    drawcolumn_t        dc[4];
+    int                 savedlinesize;
+    int                 savedpixelstep;
+    int                 savedcentery;
+    int                 savedcolumnofs[SCREENWIDTH];
+    byte*               savedylookup[SCREENHEIGHT];
+    int                 i;
+    int                 j;
+    int                 n;
+
+    ref = Z_Malloc (SCREENWIDTH*SCREENHEIGHT, PU_STATIC, NULL);
+    test = Z_Malloc (SCREENWIDTH*SCREENHEIGHT, PU_STATIC, NULL);
+    source = Z_Malloc (4096, PU_STATIC, NULL);
+    colormap = Z_Malloc (256, PU_STATIC, NULL);
+
+    // The kernels draw through the view tables; point them at the
+    //  test buffers, as a full screen row major view.
+    savedlinesize = linesize;
+    savedpixelstep = pixelstep;
+    savedcentery = centery;
+    memcpy (savedcolumnofs, columnofs, sizeof(savedcolumnofs));
+    memcpy (savedylookup, ylookup, sizeof(savedylookup));
+
+    linesize = SCREENWIDTH;
+    pixelstep = 1;
+    centery = SCREENHEIGHT/2;
+
+    for (i=0 ; i<SCREENWIDTH ; i++)
+        columnofs[i] = i;
+
+    kernelseed = 1;
+
+    for (i=0 ; i<4096 ; i++)
+        source[i] = R_KernelRandom (256);
+
+    for (i=0 ; i<256 ; i++)
+        colormap[i] = R_KernelRandom (256);
+
+    memset (ref, 0, SCREENWIDTH*SCREENHEIGHT);
+    memset (test, 0, SCREENWIDTH*SCREENHEIGHT);
+
+    for (n=0 ; n<KERNELTESTS ; n++)
+    {
+        // a span in full detail
+        ds.y = R_KernelRandom (SCREENHEIGHT);
+        ds.x1 = R_KernelRandom (SCREENWIDTH);
+        ds.x2 = ds.x1 + R_KernelRandom (SCREENWIDTH - ds.x1);
+        ds.position = ((unsigned int) R_KernelRandom (0x10000) << 16)
+                    | R_KernelRandom (0x10000);
+        ds.step = ((unsigned int) R_KernelRandom (0x10000) << 16)
+                | R_KernelRandom (0x10000);
+        ds.source = source;
+        ds.colormap = colormap;
+
+        R_KernelTestBuffer (ref);
+        R_DrawSpanKernel (&ds);
+        R_KernelTestBuffer (test);
+        R_DrawSpanWideKernel (&ds);
+        R_KernelTestCompare (ref, test, "R_DrawSpanWideKernel", n);
+
+        // a span in low detail
+        ds.y = R_KernelRandom (SCREENHEIGHT/2);
+        ds.x1 = R_KernelRandom (SCREENWIDTH/2);
+        ds.x2 = ds.x1 + R_KernelRandom (SCREENWIDTH/2 - ds.x1);
+
+        R_KernelTestBuffer (ref);
+        R_DrawSpanLowKernel (&ds);
+        R_KernelTestBuffer (test);
+        R_DrawSpanLowWideKernel (&ds);
+        R_KernelTestCompare (ref, test, "R_DrawSpanLowWideKernel", n);
+
+        // four neighbouring base columns, with ragged ends
+        j = R_KernelRandom (SCREENWIDTH - 3);
+
+        for (i=0 ; i<4 ; i++)
+        {
+            dc[i].x = j + i;
+            dc[i].yl = R_KernelRandom (SCREENHEIGHT);
+            dc[i].yh = dc[i].yl + R_KernelRandom (SCREENHEIGHT - dc[i].yl);
+            dc[i].texheight = texheights[R_KernelRandom (5)];
+            dc[i].iscale = R_KernelRandom (4 << FRACBITS);
+            dc[i].texturemid = R_KernelRandom (256 << FRACBITS)
+                             - (128 << FRACBITS);
+            dc[i].source = source + R_KernelRandom (4096 - 128);
+            dc[i].colormap = colormap;
+        }
+
+        R_KernelTestBuffer (ref);
+        for (i=0 ; i<4 ; i++)
+            R_DrawColumnKernel (&dc[i]);
+        R_KernelTestBuffer (test);
+        widestores = true;
+        R_DrawColumnQuadKernel (dc);
+        R_KernelTestCompare (ref, test, "R_DrawColumnQuadKernel", n);
+    }
+
+    linesize = savedlinesize;
+    pixelstep = savedpixelstep;
+    centery = savedcentery;
+    memcpy (columnofs, savedcolumnofs, sizeof(savedcolumnofs));
+    memcpy (ylookup, savedylookup, sizeof(savedylookup));
+
+    Z_Free (ref);
+    Z_Free (test);
+    Z_Free (source);
+    Z_Free (colormap);
+
+    C_Printf (" R_TestKernels: %i spans and column groups match\n",
+              KERNELTESTS);
+}
+
+
+//
+// R_InitKernels
+// Picks the span drawers, and whether quad columns are stored a word
+//  at a time.  Words are only stored into the usual row major view.
+//
+void R_InitKernels (void)
+{
+    //!
+    // @category video
+    //
+    // Draw the 3D view a byte at a time, with the original span and
+    // column drawers.
+    //
+
+    //!
+    // @category video
+    //
+    // Check at startup that the word-store span and column drawers
+    // give the same pixels as the byte at a time ones.
+    //
+
+    if (M_CheckParm ("-kerneltest"))
+        R_TestKernels ();
+
+    if (viewbuffer || M_CheckParm ("-scalarkernels"))
+    {
+        widestores = false;
+        drawspankernel = R_DrawSpanKernel;
+        drawspanlowkernel = R_DrawSpanLowKernel;
+    }
+    else
+    {
+        widestores = true;
+        drawspankernel = R_DrawSpanWideKernel;
+        drawspanlowkernel = R_DrawSpanLowWideKernel;
+    }
+}
+
+
+//
+// R_TransposeViewBuffer
+// Copies the column major view to the screen, in tiles so that both
+//  buffers are read and written a few cache lines at a time.
+//
+#define TRANSPOSETILE  16
+
+void R_TransposeViewBuffer (void)
+{
+    byte*              src;
+    byte*              dest;
+    int                tx;
+    int                ty;
+    int                x;
+    int                y;
+    int                x2;
+    int                y2;
+
+    if (!viewbuffer)
+        return;
+
+    for (ty=0 ; ty<scaledviewheight ; ty+=TRANSPOSETILE)
+    {
+        y2 = ty + TRANSPOSETILE;
+
+        if (y2 > scaledviewheight)
+            y2 = scaledviewheight;
+
+        for (tx=0 ; tx<scaledviewwidth ; tx+=TRANSPOSETILE)
+        {
+            x2 = tx + TRANSPOSETILE;
+
+            if (x2 > scaledviewwidth)
+                x2 = scaledviewwidth;
+
+            for (y=ty ; y<y2 ; y++)
+            {
+                src = viewbuffer + y;
+                dest = I_VideoBuffer + (y+viewwindowy)*SCREENWIDTH
+                     + viewwindowx;
+
+                for (x=tx ; x<x2 ; x++)
+                    dest[x] = src[x*SCREENHEIGHT];
+            }
+        }
+    }
+}
  
  
 
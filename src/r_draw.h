@@ -29,6 +29,42 @@
 #define __R_DRAW__
 
 
+#define FUZZTABLE      50 
+
+
+//
+// Everything a column or span drawer reads, so that a draw can be
+// kept and carried out later (see r_bands.c).  The usual drawers
+// fill one in from the dc_* and ds_* globals and call the kernel
+// straight away.
+//
+typedef struct
+{
+    int                 x;
+    int                 yl;
+    int                 yh;
+    int                 texheight;
+    fixed_t             iscale;
+    fixed_t             texturemid;
+    byte*               source;
+    lighttable_t*       colormap;
+    byte*               translation;
+    int                 fuzzpos;
+} drawcolumn_t;
+
+typedef struct
+{
+    int                 y;
+    int                 x1;
+    int                 x2;
+
+    // x in the top 16 bits and y in the bottom 16 bits, 6.10 fixed
+    unsigned int        position;
+    unsigned int        step;
+
+    byte*               source;
+    lighttable_t*       colormap;
+} drawspan_t;
 
 
 extern lighttable_t*        dc_colormap;
@@ -59,6 +95,42 @@ void         R_DrawFuzzColumnLow (void);
 void        R_DrawTranslatedColumn (void);
 void        R_DrawTranslatedColumnLow (void);
 
+void         R_DrawColumnKernel (drawcolumn_t *dc);
+void         R_DrawColumnLowKernel (drawcolumn_t *dc);
+void         R_DrawFuzzColumnKernel (drawcolumn_t *dc);
+void         R_DrawFuzzColumnLowKernel (drawcolumn_t *dc);
+void         R_DrawTranslatedColumnKernel (drawcolumn_t *dc);
+void         R_DrawTranslatedColumnLowKernel (drawcolumn_t *dc);
+
+// Fill in a column from the dc_* globals.
+void         R_SaveColumn (drawcolumn_t *dc);
+
+// Four base columns at adjacent x, drawn together.
+void         R_DrawColumnQuadKernel (drawcolumn_t *dc);
+
+// Base columns in high detail, put off to be drawn four at a time.
+void         R_BatchColumn (void);
+
+// The wall tier a base column belongs to.  R_RenderSegLoop draws the
+//  tiers at one x before moving to the next, so R_BatchColumn puts
+//  each tier off on its own; everything else is COL_OTHER.
+typedef enum
+{
+    COL_OTHER,
+    COL_TOP,
+    COL_MID,
+    COL_BOTTOM,
+
+    NUMCOLSLOTS
+} colslot_t;
+
+extern colslot_t        dc_slot;
+
+// Draw the columns R_BatchColumn has put off.
+void         R_FlushColumns (void);
+
+extern int                fuzzpos;
+
 void
 R_VideoErase
 ( unsigned        ofs,
@@ -89,12 +161,35 @@ void         R_DrawSpan (void);
 // Low resolution mode, 160x200?
 void         R_DrawSpanLow (void);
 
+void         R_DrawSpanKernel (drawspan_t *ds);
+void         R_DrawSpanLowKernel (drawspan_t *ds);
+
+// The same, storing a word at a time.
+void         R_DrawSpanWideKernel (drawspan_t *ds);
+void         R_DrawSpanLowWideKernel (drawspan_t *ds);
+
+// The span kernels picked by R_InitKernels.
+extern void  (*drawspankernel) (drawspan_t *ds);
+extern void  (*drawspanlowkernel) (drawspan_t *ds);
+
+// Fill in a span from the ds_* globals.
+void         R_SaveSpan (drawspan_t *ds);
+
 
 void
 R_InitBuffer
 ( int                width,
   int                height );
 
+// Column major drawing (-columnmajor).
+void        R_InitViewBuffer (void);
+
+// Pick the kernels to draw with.
+void        R_InitKernels (void);
+
+// Copy the finished view to the screen.
+void        R_TransposeViewBuffer (void);
+
 
 // Initialize color translation tables,
 //  for player rendering etc.
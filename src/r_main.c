@@ -36,10 +36,15 @@
 #include "d_loop.h"
 #include "d_player.h"
 #include "doomdef.h"
+#include "i_timer.h"
+#include "m_argv.h"
 #include "m_bbox.h"
 #include "m_menu.h"
+#include "r_bands.h"
 #include "r_local.h"
+#include "r_prof.h"
 #include "r_sky.h"
+#include "z_zone.h"
 
 
 
@@ -629,7 +634,7 @@ void R_ExecuteSetViewSize (void)
 
     if (!detailshift)
     {
-        colfunc = basecolfunc = R_DrawColumn;
+        colfunc = basecolfunc = R_BatchColumn;
         fuzzcolfunc = R_DrawFuzzColumn;
         transcolfunc = R_DrawTranslatedColumn;
         spanfunc = R_DrawSpan;
@@ -642,6 +647,8 @@ void R_ExecuteSetViewSize (void)
         spanfunc = R_DrawSpanLow;
     }
 
+    R_SetBandFuncs ();
+
     R_InitBuffer (scaledviewwidth, scaledviewheight); // CHANGED FOR HIRES
         
     R_InitTextureMapping ();
@@ -692,6 +699,113 @@ void R_ExecuteSetViewSize (void)
 
 
 
+//
+// R_FlushDraws
+// Carries out the draws that have been put off.  Also done before
+//  the zone throws out any cached patch or flat they might use.
+//
+static void R_FlushDraws (void)
+{
+    R_FlushColumns ();
+    R_FlushBands ();
+}
+
+
+
+//
+// Adaptive detail
+// With -renderbudget, the view drops to low detail while drawing it
+//  takes longer than the budget, and goes back to high detail once
+//  it has been well under the budget for a while.  Only done when
+//  high detail is chosen in the menu; detailLevel is left alone.
+//
+
+// Frames over the budget before dropping to low detail.
+#define ADAPTDOWNFRAMES         4
+
+// Frames under ADAPTUPPERCENT of the budget before going back to
+//  high detail.  Doubled each time high detail doesn't last that long,
+//  so a scene right at the budget doesn't flicker between the two.
+#define ADAPTUPFRAMES           70
+#define ADAPTMAXUPFRAMES        (ADAPTUPFRAMES*16)
+#define ADAPTUPPERCENT          60
+
+static unsigned int        renderbudget;       // microseconds, 0 = off
+static unsigned int        rendertime;         // running average
+static int                 adaptframes;
+static int                 adaptupframes = ADAPTUPFRAMES;
+static int                 highframes = ADAPTUPFRAMES;
+
+static void R_InitAdaptiveDetail (void)
+{
+    int                p;
+
+    //!
+    // @arg <ms>
+    // @category video
+    //
+    // Drop to low detail while drawing the 3D view takes longer than
+    // ms milliseconds (16.6 for 60 frames a second), and go back to
+    // high detail when there is time to spare.
+    //
+
+    p = M_CheckParmWithArgs ("-renderbudget", 1);
+
+    if (p)
+        renderbudget = (unsigned int) (atof (myargv[p+1]) * 1000);
+}
+
+static void R_AdaptDetail (unsigned int time)
+{
+    if (!renderbudget || detailLevel || setsizeneeded)
+        return;
+
+    rendertime -= rendertime / 8;
+    rendertime += time / 8;
+
+    if (!detailshift)
+    {
+        highframes++;
+
+        if (rendertime <= renderbudget)
+        {
+            adaptframes = 0;
+            return;
+        }
+
+        if (++adaptframes < ADAPTDOWNFRAMES)
+            return;
+
+        // back down too soon: wait longer before trying again
+        if (highframes < adaptupframes)
+        {
+            if (adaptupframes < ADAPTMAXUPFRAMES)
+                adaptupframes *= 2;
+        }
+        else
+            adaptupframes = ADAPTUPFRAMES;
+
+        R_SetViewSize (setblocks, 1);
+    }
+    else
+    {
+        if (rendertime >= renderbudget / 100 * ADAPTUPPERCENT)
+        {
+            adaptframes = 0;
+            return;
+        }
+
+        if (++adaptframes < adaptupframes)
+            return;
+
+        highframes = 0;
+        R_SetViewSize (setblocks, 0);
+    }
+
+    adaptframes = 0;
+}
+
+
 //
 // R_Init
 //
@@ -714,6 +828,12 @@ void R_Init (void)
     C_Printf (".");
 
 
+    R_InitViewBuffer ();
+    R_InitKernels ();
+    R_InitBands ();
+    R_InitAdaptiveDetail ();
+    R_ProfInit ();
+    Z_SetPurgeCallback (R_FlushDraws);
     R_SetViewSize (screenblocks, detailLevel);
     R_InitPlanes ();
     printf (".");
@@ -845,6 +965,11 @@ void R_SetupFrame (player_t* player)
 //
 void R_RenderPlayerView (player_t* player)
 {        
+    unsigned int        starttime;
+
+    starttime = I_GetTimeUS ();
+
+    R_ProfStart (PROF_SETUP);
     R_SetupFrame (player);
 
     // Clear buffers.
@@ -852,22 +977,37 @@ void R_RenderPlayerView (player_t* player)
     R_ClearDrawSegs ();
     R_ClearPlanes ();
     R_ClearSprites ();
+    R_ProfStop (PROF_SETUP);
     
     // check for new console commands.
     NetUpdate ();
 
     // The head node is the last node output.
+    R_ProfStart (PROF_BSP);
     R_RenderBSPNode (numnodes-1);
+    R_ProfStop (PROF_BSP);
     
     // Check for new console commands.
     NetUpdate ();
     
+    R_ProfStart (PROF_PLANES);
     R_DrawPlanes ();
+    R_ProfStop (PROF_PLANES);
     
     // Check for new console commands.
     NetUpdate ();
     
+    R_ProfStart (PROF_MASKED);
     R_DrawMasked ();
+    R_ProfStop (PROF_MASKED);
+
+    R_ProfStart (PROF_FLUSH);
+    R_FlushDraws ();
+    R_TransposeViewBuffer ();
+    R_ProfStop (PROF_FLUSH);
+
+    R_ProfCountView ();
+    R_AdaptDetail (I_GetTimeUS () - starttime);
 
     // Check for new console commands.
     NetUpdate ();                                
@@ -46,6 +46,15 @@
 // ?
 #define MAXOPENINGS        SCREENWIDTH*64*4  // CHANGED FOR HIRES
 
+// Visplanes are kept in hash chains on height, flat and light level,
+//  so R_FindPlane only compares against planes that could match.
+//  The chains hold indexes, as visplanes moves when it is raised.
+#define VISPLANEHASH       512
+
+#define R_VisplaneHash(height, picnum, lightlevel)                  \
+    ((unsigned) (((height) >> FRACBITS) * 7 + (picnum) * 3            \
+                 + (lightlevel)) & (VISPLANEHASH - 1))
+
 
 planefunction_t            floorfunc;
 planefunction_t            ceilingfunc;
@@ -74,6 +83,13 @@ fixed_t                    cachedystep[SCREENHEIGHT];
 
 static int                 numvisplanes;             // ADDED FOR HIRES
 
+static int                 visplanehead[VISPLANEHASH];
+static int                 visplanetail[VISPLANEHASH];
+
+// Visplanes in the order R_DrawPlanes draws them
+static visplane_t**        sortedplanes = NULL;
+static int                 numsortedplanes;
+
 int                        openings[MAXOPENINGS];    // CHANGED FOR HIRES
 int*                       lastopening;              // CHANGED FOR HIRES
 
@@ -192,6 +208,9 @@ void R_ClearPlanes (void)
 
     lastvisplane = visplanes;
     lastopening = openings;
+
+    memset (visplanehead, 0xff, sizeof(visplanehead));
+    memset (visplanetail, 0xff, sizeof(visplanetail));
     
     // texture calculation
     memset (cachedheight, 0, sizeof(cachedheight));
@@ -230,6 +249,27 @@ static void R_RaiseVisplanes (visplane_t** vp)
 }
 
 
+//
+// R_HashVisplane
+// Adds a new visplane to the end of its hash chain, so each chain
+//  stays in the order the planes were made.
+//
+static void R_HashVisplane (visplane_t* pl)
+{
+    unsigned int hash = R_VisplaneHash(pl->height, pl->picnum, pl->lightlevel);
+    int          i = pl - visplanes;
+
+    pl->next = -1;
+
+    if (visplanetail[hash] < 0)
+        visplanehead[hash] = i;
+    else
+        visplanes[visplanetail[hash]].next = i;
+
+    visplanetail[hash] = i;
+}
+
+
 //
 // R_FindPlane
 //
@@ -240,6 +280,7 @@ R_FindPlane
   int            lightlevel )
 {
     visplane_t*  check;
+    int          i;
         
     if (picnum == skyflatnum)
     {
@@ -247,19 +288,21 @@ R_FindPlane
         lightlevel = 0;
     }
         
-    for (check=visplanes; check<lastvisplane; check++)
+    for (i = visplanehead[R_VisplaneHash(height, picnum, lightlevel)];
+         i >= 0;
+         i = check->next)
     {
+        check = &visplanes[i];
+
         if (height == check->height
             && picnum == check->picnum
             && lightlevel == check->lightlevel)
         {
-            break;
+            return check;
         }
     }
-    
-                        
-    if (check < lastvisplane)
-        return check;
+
+    check = lastvisplane;
 
     R_RaiseVisplanes(&check);
 
@@ -272,6 +315,8 @@ R_FindPlane
     check->maxx = -1;
     
     memset (check->top,0xff,sizeof(check->top));
+
+    R_HashVisplane (check);
                 
     return check;
 }
@@ -340,6 +385,8 @@ R_CheckPlane
     pl->maxx = stop;
 
     memset (pl->top,0xff,sizeof(pl->top));
+
+    R_HashVisplane (pl);
                 
     return pl;
 }
@@ -381,6 +428,30 @@ R_MakeSpans
 
 
 
+//
+// R_ComparePlanes
+// Orders visplanes by flat, then light level, then height, so that
+//  planes sharing a flat and colormaps are drawn back to back.
+//  Visplanes never overlap, so the order does not change the picture.
+//
+static int R_ComparePlanes (const void* a, const void* b)
+{
+    const visplane_t*   pa = *(const visplane_t**) a;
+    const visplane_t*   pb = *(const visplane_t**) b;
+
+    if (pa->picnum != pb->picnum)
+        return pa->picnum < pb->picnum ? -1 : 1;
+
+    if (pa->lightlevel != pb->lightlevel)
+        return pa->lightlevel < pb->lightlevel ? -1 : 1;
+
+    if (pa->height != pb->height)
+        return pa->height < pb->height ? -1 : 1;
+
+    return pa < pb ? -1 : pa > pb;
+}
+
+
 //
 // R_DrawPlanes
 // At the end of each frame.
@@ -393,6 +464,10 @@ void R_DrawPlanes (void)
     int                 stop;
     int                 angle;
     int                 lumpnum;
+    int                 picnum;
+    int                 lightlevel;
+    int                 count;
+    int                 i;
                                 
 #ifdef RANGECHECK
 
@@ -409,11 +484,32 @@ void R_DrawPlanes (void)
                  lastopening - openings);
 #endif
 
+    if (numsortedplanes < numvisplanes)
+    {
+        numsortedplanes = numvisplanes;
+        sortedplanes = realloc(sortedplanes,
+                               numsortedplanes * sizeof(*sortedplanes));
+    }
+
+    count = 0;
+
     for (pl = visplanes ; pl < lastvisplane ; pl++)
     {
-        if (pl->minx > pl->maxx)
-            continue;
+        if (pl->minx <= pl->maxx)
+            sortedplanes[count++] = pl;
+    }
+
+    qsort (sortedplanes, count, sizeof(*sortedplanes), R_ComparePlanes);
 
+    // Each flat is cached once and kept until all its planes are
+    //  drawn.
+    lumpnum = -1;
+    picnum = -1;
+    lightlevel = -1;
+
+    for (i = 0 ; i < count ; i++)
+    {
+        pl = sortedplanes[i];
         
         // sky flat
         if (pl->picnum == skyflatnum)
@@ -447,19 +543,32 @@ void R_DrawPlanes (void)
         }
         
         // regular flat
-        lumpnum = firstflat + flattranslation[pl->picnum];
-        ds_source = W_CacheLumpNum(lumpnum, PU_STATIC);
+        if (pl->picnum != picnum)
+        {
+            if (lumpnum >= 0)
+                W_ReleaseLumpNum(lumpnum);
+
+            picnum = pl->picnum;
+            lumpnum = firstflat + flattranslation[picnum];
+            ds_source = W_CacheLumpNum(lumpnum, PU_STATIC);
+            lightlevel = -1;
+        }
         
         planeheight = abs(pl->height-viewz);
-        light = (pl->lightlevel >> LIGHTSEGSHIFT)+extralight;
 
-        if (light >= LIGHTLEVELS)
-            light = LIGHTLEVELS-1;
+        if (pl->lightlevel != lightlevel)
+        {
+            lightlevel = pl->lightlevel;
+            light = (lightlevel >> LIGHTSEGSHIFT)+extralight;
+
+            if (light >= LIGHTLEVELS)
+                light = LIGHTLEVELS-1;
 
-        if (light < 0)
-            light = 0;
+            if (light < 0)
+                light = 0;
 
-        planezlight = zlight[light];
+            planezlight = zlight[light];
+        }
 
         pl->top[pl->maxx+1] = 0xffffffffu;                        // CHANGED FOR HIRES
         pl->top[pl->minx-1] = 0xffffffffu;                        // CHANGED FOR HIRES
@@ -473,8 +582,9 @@ void R_DrawPlanes (void)
                         pl->top[x],
                         pl->bottom[x]);
         }
-        
-        W_ReleaseLumpNum(lumpnum);
     }
+
+    if (lumpnum >= 0)
+        W_ReleaseLumpNum(lumpnum);
 }
 
@@ -0,0 +1,319 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//
+// DESCRIPTION:
+//        Time spent in each stage of drawing a frame.
+//
+//        Each stage is timed with I_GetTimeUS, and the times and view
+//        counts of the last PROFFRAMES frames are kept, so that the
+//        overlay, the "profstats" console command and the reports
+//        written at the end of each level and at exit show averages
+//        rather than the jitter of single frames.
+//
+//-----------------------------------------------------------------------------
+
+
+#include <stdio.h>
+
+#include "c_io.h"
+#include "doomstat.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_menu.h"
+#include "r_local.h"
+#include "r_prof.h"
+
+
+// One second of frames at the game's tic rate.
+#define PROFFRAMES              35
+
+typedef enum
+{
+    PROF_DRAWSEGS,
+    PROF_VISPLANES,
+    PROF_VISSPRITES,
+    PROF_OPENINGS,
+    PROF_COLUMNS,
+    PROF_SPANS,
+
+    NUMPROFCOUNTS
+} profcount_t;
+
+static char *stagenames[NUMPROFSTAGES] =
+{
+    "setup", "bsp", "planes", "masked", "flush", "hud", "finish", "scale"
+};
+
+static char *countnames[NUMPROFCOUNTS] =
+{
+    "drawsegs", "visplanes", "vissprites", "openings", "columns", "spans"
+};
+
+extern visplane_t*      visplanes;
+extern visplane_t*      lastvisplane;
+extern int              openings[];
+extern int              dccount;
+extern int              dscount;
+
+boolean                 display_profile = false;
+
+// The frame being drawn.
+static unsigned int     stagestart[NUMPROFSTAGES];
+static unsigned int     stagetime[NUMPROFSTAGES];
+static int              counts[NUMPROFCOUNTS];
+static unsigned int     lastframe;
+
+// The last PROFFRAMES frames, oldest overwritten first.
+static unsigned int     stagehistory[PROFFRAMES][NUMPROFSTAGES];
+static int              counthistory[PROFFRAMES][NUMPROFCOUNTS];
+static unsigned int     framehistory[PROFFRAMES];
+static int              historypos;
+static int              historylength;
+
+
+void R_ProfStart (profstage_t stage)
+{
+    stagestart[stage] = I_GetTimeUS ();
+}
+
+void R_ProfStop (profstage_t stage)
+{
+    stagetime[stage] += I_GetTimeUS () - stagestart[stage];
+}
+
+
+//
+// R_ProfCountView
+// The lists are only reset when the next view is set up, so they
+//  still hold the whole view here.
+//
+void R_ProfCountView (void)
+{
+    counts[PROF_DRAWSEGS] = ds_p - drawsegs;
+    counts[PROF_VISPLANES] = lastvisplane - visplanes;
+    counts[PROF_VISSPRITES] = vissprite_p - vissprites;
+    counts[PROF_OPENINGS] = lastopening - openings;
+    counts[PROF_COLUMNS] = dccount;
+    counts[PROF_SPANS] = dscount;
+}
+
+
+//
+// R_ProfFrame
+// Moves the frame just finished into the history.
+//
+void R_ProfFrame (void)
+{
+    unsigned int        now;
+    int                 i;
+
+    now = I_GetTimeUS ();
+
+    framehistory[historypos] = lastframe ? now - lastframe : 0;
+    lastframe = now;
+
+    for (i=0 ; i<NUMPROFSTAGES ; i++)
+    {
+        stagehistory[historypos][i] = stagetime[i];
+        stagetime[i] = 0;
+    }
+
+    for (i=0 ; i<NUMPROFCOUNTS ; i++)
+    {
+        counthistory[historypos][i] = counts[i];
+        counts[i] = 0;
+    }
+
+    dccount = 0;
+    dscount = 0;
+
+    historypos = (historypos + 1) % PROFFRAMES;
+
+    if (historylength < PROFFRAMES)
+        historylength++;
+}
+
+
+//
+// R_ProfAverages
+// Averages and peaks over the history; times are in microseconds.
+//
+static void R_ProfAverages (unsigned int *frameavg,
+                            unsigned int *framepeak,
+                            unsigned int *stageavg,
+                            unsigned int *stagepeak,
+                            int *countavg,
+                            int *countpeak)
+{
+    int                 f;
+    int                 i;
+
+    *frameavg = *framepeak = 0;
+
+    for (i=0 ; i<NUMPROFSTAGES ; i++)
+        stageavg[i] = stagepeak[i] = 0;
+
+    for (i=0 ; i<NUMPROFCOUNTS ; i++)
+        countavg[i] = countpeak[i] = 0;
+
+    if (!historylength)
+        return;
+
+    for (f=0 ; f<historylength ; f++)
+    {
+        *frameavg += framehistory[f];
+        if (framehistory[f] > *framepeak)
+            *framepeak = framehistory[f];
+
+        for (i=0 ; i<NUMPROFSTAGES ; i++)
+        {
+            stageavg[i] += stagehistory[f][i];
+            if (stagehistory[f][i] > stagepeak[i])
+                stagepeak[i] = stagehistory[f][i];
+        }
+
+        for (i=0 ; i<NUMPROFCOUNTS ; i++)
+        {
+            countavg[i] += counthistory[f][i];
+            if (counthistory[f][i] > countpeak[i])
+                countpeak[i] = counthistory[f][i];
+        }
+    }
+
+    *frameavg /= historylength;
+
+    for (i=0 ; i<NUMPROFSTAGES ; i++)
+        stageavg[i] /= historylength;
+
+    for (i=0 ; i<NUMPROFCOUNTS ; i++)
+        countavg[i] /= historylength;
+}
+
+
+//
+// R_ProfDraw
+//
+void R_ProfDraw (int x, int y)
+{
+    unsigned int        frameavg, framepeak;
+    unsigned int        stageavg[NUMPROFSTAGES];
+    unsigned int        stagepeak[NUMPROFSTAGES];
+    int                 countavg[NUMPROFCOUNTS];
+    int                 countpeak[NUMPROFCOUNTS];
+    char                text[64];
+    int                 i;
+
+    R_ProfAverages (&frameavg, &framepeak, stageavg, stagepeak,
+                    countavg, countpeak);
+
+    snprintf (text, sizeof(text), "FRAME %.2f", frameavg / 1000.0);
+    M_WriteText (x, y, text);
+    y += 8;
+
+    for (i=0 ; i<NUMPROFSTAGES ; i++)
+    {
+        snprintf (text, sizeof(text), "%s %.2f",
+                  stagenames[i], stageavg[i] / 1000.0);
+        M_WriteText (x, y, text);
+        y += 8;
+    }
+
+    for (i=0 ; i<NUMPROFCOUNTS ; i++)
+    {
+        snprintf (text, sizeof(text), "%s %d", countnames[i], countavg[i]);
+        M_WriteText (x, y, text);
+        y += 8;
+    }
+}
+
+
+//
+// R_ProfInit
+//
+void R_ProfInit (void)
+{
+    //!
+    // @category video
+    //
+    // Show the time spent in each stage of drawing the view below
+    // the FPS counter, and write it out at the end of each level
+    // and at exit.
+    //
+
+    if (M_CheckParm ("-profile"))
+        display_profile = true;
+}
+
+
+//
+// R_ProfToggle
+//
+void R_ProfToggle (void)
+{
+    display_profile = !display_profile;
+
+    C_Printf ("render profile %s\n", display_profile ? "on" : "off");
+}
+
+
+//
+// R_ProfWriteStats
+// Writes the averages and peaks to f, or to the console.
+//
+void R_ProfWriteStats (FILE* f)
+{
+    unsigned int        frameavg, framepeak;
+    unsigned int        stageavg[NUMPROFSTAGES];
+    unsigned int        stagepeak[NUMPROFSTAGES];
+    int                 countavg[NUMPROFCOUNTS];
+    int                 countpeak[NUMPROFCOUNTS];
+    int                 i;
+
+    R_ProfAverages (&frameavg, &framepeak, stageavg, stagepeak,
+                    countavg, countpeak);
+
+    C_FPrintf (f, "render profile over the last %i frames (avg / peak)\n",
+               historylength);
+    C_FPrintf (f, " frame: %.2f / %.2f ms\n",
+               frameavg / 1000.0, framepeak / 1000.0);
+
+    for (i=0 ; i<NUMPROFSTAGES ; i++)
+    {
+        C_FPrintf (f, " %s: %.2f / %.2f ms\n", stagenames[i],
+                   stageavg[i] / 1000.0, stagepeak[i] / 1000.0);
+    }
+
+    for (i=0 ; i<NUMPROFCOUNTS ; i++)
+    {
+        C_FPrintf (f, " %s: %i / %i\n", countnames[i],
+                   countavg[i], countpeak[i]);
+    }
+}
+
+
+//
+// R_ProfDumpStats
+//
+void R_ProfDumpStats (void)
+{
+    R_ProfWriteStats (NULL);
+}
@@ -0,0 +1,79 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+//
+// DESCRIPTION:
+//        Time spent in each stage of drawing a frame.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __R_PROF__
+#define __R_PROF__
+
+#include <stdio.h>
+
+#include "doomtype.h"
+
+
+typedef enum
+{
+    PROF_SETUP,         // R_SetupFrame and clearing the view lists
+    PROF_BSP,           // R_RenderBSPNode
+    PROF_PLANES,        // R_DrawPlanes
+    PROF_MASKED,        // R_DrawMasked
+    PROF_FLUSH,         // queued draws and the view buffer copy
+    PROF_HUD,           // ST_Drawer and HU_Drawer
+    PROF_FINISH,        // I_FinishUpdate, scaler included
+    PROF_SCALE,         // the scaler alone
+
+    NUMPROFSTAGES
+} profstage_t;
+
+// Show the stage times below the FPS counter.
+extern boolean          display_profile;
+
+// Turn the overlay on if -profile was given.
+void R_ProfInit (void);
+
+// Time a stage of the current frame.  A stage may be timed more
+//  than once a frame; the times are added up.
+void R_ProfStart (profstage_t stage);
+void R_ProfStop (profstage_t stage);
+
+// Take the drawseg, visplane, vissprite, opening, column and span
+//  counts of the view just drawn.
+void R_ProfCountView (void);
+
+// Called once the frame is on the screen.
+void R_ProfFrame (void);
+
+// Draw the averages at x, y (in 320x200 coordinates).
+void R_ProfDraw (int x, int y);
+
+// Write the averages and peaks to f, or to the console if f is NULL.
+void R_ProfWriteStats (FILE* f);
+
+// Console commands.
+void R_ProfToggle (void);
+void R_ProfDumpStats (void);
+
+#endif
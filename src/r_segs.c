@@ -398,6 +398,7 @@ void R_RenderSegLoop (void)
             dc_texturemid = rw_midtexturemid;
             dc_source = R_GetColumn(midtexture,texturecolumn);
             dc_texheight = textureheight[midtexture]>>FRACBITS; // Tutti-Frutti fix
+            dc_slot = COL_MID;
             colfunc ();
             ceilingclip[rw_x] = viewheight;
             floorclip[rw_x] = -1;
@@ -421,6 +422,7 @@ void R_RenderSegLoop (void)
                     dc_texturemid = rw_toptexturemid;
                     dc_source = R_GetColumn(toptexture,texturecolumn);
                     dc_texheight = textureheight[toptexture]>>FRACBITS; // Tutti-Frutti fix
+                    dc_slot = COL_TOP;
                     colfunc ();
                     ceilingclip[rw_x] = mid;
                 }
@@ -452,6 +454,7 @@ void R_RenderSegLoop (void)
                     dc_source = R_GetColumn(bottomtexture,
                                             texturecolumn);
                     dc_texheight = textureheight[bottomtexture]>>FRACBITS; // Tutti-Frutti fix
+                    dc_slot = COL_BOTTOM;
                     colfunc ();
                     floorclip[rw_x] = mid;
                 }
@@ -477,6 +480,8 @@ void R_RenderSegLoop (void)
         topfrac += topstep;
         bottomfrac += bottomstep;
     }
+
+    dc_slot = COL_OTHER;
 }
 
 
@@ -91,6 +91,17 @@ vissprite_t*           vissprite_p;
 vissprite_t            overflowsprite;
 vissprite_t            vsprsortedhead;
 
+// Drawsegs that can clip sprites, binned by screen x.  Level l cuts
+//  the view into 2^l bins, and each bin lists the drawsegs touching
+//  it, latest first.  A sprite only looks at the bin of the deepest
+//  level that holds its whole x range.
+#define DRAWSEGLEVELS          5
+#define DRAWSEGBINS            ((1 << DRAWSEGLEVELS) - 1)
+
+static int             drawsegbinstart[DRAWSEGBINS + 1];
+static int*            drawsegbinlist = NULL;
+static int             numdrawsegbinlist;
+
 //
 // Sprite rotation 0 is facing the viewer,
 //  rotation 1 is one angle turn CLOCKWISE around the axis.
@@ -836,69 +847,170 @@ void R_DrawPlayerSprites (void)
 
 
 
+//
+// R_MergeVisSprites
+// Merges two lists sorted by scale.  On equal scales the first list
+//  goes first, so sprites keep the order they were made in.
+//
+static vissprite_t* R_MergeVisSprites (vissprite_t* a, vissprite_t* b)
+{
+    vissprite_t*       head;
+    vissprite_t**      tail = &head;
+
+    while (a && b)
+    {
+        if (b->scale < a->scale)
+        {
+            *tail = b;
+            b = b->next;
+        }
+        else
+        {
+            *tail = a;
+            a = a->next;
+        }
+        tail = &(*tail)->next;
+    }
+
+    *tail = a ? a : b;
+
+    return head;
+}
+
+
 //
 // R_SortVisSprites
+// Stable merge sort on scale, giving the same order as the selection
+//  sort it replaces.
 //
 
 void R_SortVisSprites (void)
 {
-    int                i;
-    int                count;
+    vissprite_t*       lists[32];
+    vissprite_t*       carry;
     vissprite_t*       ds;
-    vissprite_t*       best;
-    vissprite_t        unsorted;
-    fixed_t            bestscale;
+    vissprite_t*       prev;
+    int                i;
 
-    count = vissprite_p - vissprites;
-        
-    unsorted.next = unsorted.prev = &unsorted;
+    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
 
-    if (!count)
+    if (vissprite_p == vissprites)
         return;
-                
+
+    // lists[i] is empty or holds 2^i sprites, made before those in
+    //  any lower list
+    memset (lists, 0, sizeof(lists));
+
     for (ds=vissprites ; ds<vissprite_p ; ds++)
     {
-        ds->next = ds+1;
-        ds->prev = ds-1;
+        ds->next = NULL;
+        carry = ds;
+
+        for (i=0 ; lists[i] ; i++)
+        {
+            carry = R_MergeVisSprites (lists[i], carry);
+            lists[i] = NULL;
+        }
+
+        lists[i] = carry;
+    }
+
+    carry = NULL;
+
+    for (i=0 ; i<32 ; i++)
+    {
+        if (lists[i])
+            carry = R_MergeVisSprites (lists[i], carry);
     }
-    
-    vissprites[0].prev = &unsorted;
-    unsorted.next = &vissprites[0];
-    (vissprite_p-1)->next = &unsorted;
-    unsorted.prev = vissprite_p-1;
-    
-    // pull the vissprites out by scale
 
-    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
-    for (i=0 ; i<count ; i++)
+    // link up the sorted list
+    prev = &vsprsortedhead;
+
+    for (ds=carry ; ds ; ds=ds->next)
     {
-        bestscale = INT_MAX;
-        best = unsorted.next;
-        for (ds=unsorted.next ; ds!= &unsorted ; ds=ds->next)
+        ds->prev = prev;
+        prev->next = ds;
+        prev = ds;
+    }
+
+    prev->next = &vsprsortedhead;
+    vsprsortedhead.prev = prev;
+}
+
+
+
+//
+// R_BinDrawSegs
+// Files the drawsegs with a silhouette or masked mid texture into the
+//  bins of every level they touch.
+//
+static void R_BinDrawSegs (void)
+{
+    drawseg_t*         ds;
+    int                fill[DRAWSEGBINS];
+    int                level;
+    int                bins;
+    int                b;
+    int                b2;
+    int                pass;
+
+    memset (fill, 0, sizeof(fill));
+
+    // count the entries of each bin first, then fill them in
+    for (pass=0 ; pass<2 ; pass++)
+    {
+        for (ds=ds_p-1 ; ds >= drawsegs ; ds--)
         {
-            if (ds->scale < bestscale)
+            if (!ds->silhouette && !ds->maskedtexturecol)
+                continue;
+
+            for (level=0 ; level<DRAWSEGLEVELS ; level++)
             {
-                bestscale = ds->scale;
-                best = ds;
+                bins = 1 << level;
+                b2 = ds->x2 * bins / viewwidth;
+
+                for (b = ds->x1 * bins / viewwidth ; b <= b2 ; b++)
+                {
+                    if (pass)
+                        drawsegbinlist[fill[bins-1+b]++] = ds - drawsegs;
+                    else
+                        fill[bins-1+b]++;
+                }
             }
         }
-        best->next->prev = best->prev;
-        best->prev->next = best->next;
-        best->next = &vsprsortedhead;
-        best->prev = vsprsortedhead.prev;
-        vsprsortedhead.prev->next = best;
-        vsprsortedhead.prev = best;
+
+        if (pass)
+            break;
+
+        drawsegbinstart[0] = 0;
+
+        for (b=0 ; b<DRAWSEGBINS ; b++)
+        {
+            drawsegbinstart[b+1] = drawsegbinstart[b] + fill[b];
+            fill[b] = drawsegbinstart[b];
+        }
+
+        if (drawsegbinstart[DRAWSEGBINS] > numdrawsegbinlist)
+        {
+            numdrawsegbinlist = drawsegbinstart[DRAWSEGBINS];
+            drawsegbinlist = realloc(drawsegbinlist,
+                                     numdrawsegbinlist * sizeof(*drawsegbinlist));
+        }
     }
 }
 
 
-
 //
 // R_DrawSprite
 //
 void R_DrawSprite (vissprite_t* spr)
 {
     drawseg_t*         ds;
+    int                level;
+    int                bins;
+    int                bin;
+    int                i;
+    int                end;
 
     int                clipbot[SCREENWIDTH];                        // CHANGED FOR HIRES
     int                cliptop[SCREENWIDTH];                        // CHANGED FOR HIRES
@@ -912,11 +1024,25 @@ void R_DrawSprite (vissprite_t* spr)
     for (x = spr->x1 ; x<=spr->x2 ; x++)
         clipbot[x] = cliptop[x] = -2;
     
+    // Only drawsegs in the bin holding the whole sprite can touch it.
+    for (level=DRAWSEGLEVELS-1 ; ; level--)
+    {
+        bins = 1 << level;
+        bin = spr->x1 * bins / viewwidth;
+
+        if (bin == spr->x2 * bins / viewwidth)
+            break;
+    }
+
+    end = drawsegbinstart[bins+bin];
+
     // Scan drawsegs from end to start for obscuring segs.
     // The first drawseg that has a greater scale
     //  is the clip seg.
-    for (ds=ds_p-1 ; ds >= drawsegs ; ds--)
+    for (i=drawsegbinstart[bins-1+bin] ; i<end ; i++)
     {
+        ds = drawsegs + drawsegbinlist[i];
+
         // determine if the drawseg obscures the sprite
         if (ds->x1 > spr->x2
             || ds->x2 < spr->x1
@@ -1022,6 +1148,8 @@ void R_DrawMasked (void)
 
     if (vissprite_p > vissprites)
     {
+        R_BinDrawSegs ();
+
         // draw all vissprites back to front
         for (spr = vsprsortedhead.next ;
              spr != &vsprsortedhead ;
@@ -440,6 +440,12 @@ void S_StartSound(void *origin_p, int sfx_id)
     origin = (mobj_t *) origin_p;
     volume = snd_SfxVolume;
 
+    // -fastdemo runs the play simulation only
+    if (fastdemo)
+    {
+        return;
+    }
+
     // check for bogus sound #
     if (sfx_id < 1 || sfx_id > NUMSFX)
     {
@@ -642,6 +648,11 @@ void S_ChangeMusic(int musicnum, int looping)
     char namebuf[9];
     void *handle;
 
+    if (fastdemo)
+    {
+        return;
+    }
+
     // The Doom IWAD file has two versions of the intro music: d_intro
     // and d_introa.  The latter is used for OPL playback.
 
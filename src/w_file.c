@@ -29,13 +29,28 @@
 
 #include "config.h"
 #include "doomtype.h"
+#include "m_argv.h"
 #include "w_file.h"
 
 
 extern wad_file_class_t stdc_wad_file;
 
+#ifdef HAVE_LIBZ
+extern wad_file_class_t zip_wad_file;
+#endif
+
+#ifdef HAVE_MMAP
+extern wad_file_class_t posix_wad_file;
+#endif
+
 static wad_file_class_t *wad_file_classes[] = 
 {
+#ifdef HAVE_LIBZ
+    &zip_wad_file,
+#endif
+#ifdef HAVE_MMAP
+    &posix_wad_file,
+#endif
     &stdc_wad_file,
 };
 
@@ -44,19 +59,25 @@ wad_file_t *W_OpenFile(char *path)
     wad_file_t *result;
     int i;
 
-    //!
-    // Use the OS's virtual memory subsystem to map WAD files
-    // directly into memory.
-    //
-
-    return stdc_wad_file.OpenFile(path);
-
     // Try all classes in order until we find one that works
 
     result = NULL;
 
     for (i=0; i<arrlen(wad_file_classes); ++i)
     {
+#ifdef HAVE_MMAP
+        //!
+        // Don't use the OS's virtual memory subsystem to map WAD files
+        // directly into memory; read lumps with stdio instead.
+        //
+
+        if (wad_file_classes[i] == &posix_wad_file
+         && M_CheckParm("-nommap") > 0)
+        {
+            continue;
+        }
+#endif
+
         result = wad_file_classes[i]->OpenFile(path);
 
         if (result != NULL)
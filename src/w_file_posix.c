@@ -0,0 +1,155 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2008 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+// DESCRIPTION:
+//        WAD I/O functions, using mmap() to map WAD files into memory.
+//
+//-----------------------------------------------------------------------------
+
+
+
+
+#include "config.h"
+
+#ifdef HAVE_MMAP
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include "c_io.h"
+#include "w_file.h"
+#include "z_zone.h"
+
+
+typedef struct
+{
+    wad_file_t wad;
+} posix_wad_file_t;
+
+extern wad_file_class_t posix_wad_file;
+
+// Map the whole of a file into memory, returning NULL if it can't be.
+
+static byte *MapFile(int handle, unsigned int length)
+{
+    void *result;
+
+    if (length == 0)
+    {
+        return NULL;
+    }
+
+    // Writes to the mapped area result in private changes that are
+    // *not* written to disk, so code that patches lumps in place
+    // keeps working.
+
+    result = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                  handle, 0);
+
+    if (result == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    return result;
+}
+
+static wad_file_t *W_POSIX_OpenFile(char *path)
+{
+    posix_wad_file_t *result;
+    unsigned int length;
+    byte *mapped;
+    int handle;
+
+    handle = open(path, O_RDONLY);
+
+    if (handle < 0)
+    {
+        return NULL;
+    }
+
+    length = lseek(handle, 0, SEEK_END);
+    mapped = MapFile(handle, length);
+
+    // The mapping stays valid once the file is closed.
+
+    close(handle);
+
+    if (mapped == NULL)
+    {
+        // Let the next class (stdio) have a go.
+
+        C_Printf(" W_POSIX_OpenFile: unable to mmap %s\n", path);
+        return NULL;
+    }
+
+    // Create a new posix_wad_file_t to hold the mapping.
+
+    result = Z_Malloc(sizeof(posix_wad_file_t), PU_STATIC, 0);
+    result->wad.file_class = &posix_wad_file;
+    result->wad.mapped = mapped;
+    result->wad.length = length;
+
+    return &result->wad;
+}
+
+static void W_POSIX_CloseFile(wad_file_t *wad)
+{
+    munmap(wad->mapped, wad->length);
+    Z_Free(wad);
+}
+
+// Read data from the specified position in the file into the 
+// provided buffer.  Returns the number of bytes read.
+
+static size_t W_POSIX_Read(wad_file_t *wad, unsigned int offset,
+                           void *buffer, size_t buffer_len)
+{
+    if (offset >= wad->length)
+    {
+        return 0;
+    }
+
+    if (buffer_len > wad->length - offset)
+    {
+        buffer_len = wad->length - offset;
+    }
+
+    memcpy(buffer, wad->mapped + offset, buffer_len);
+
+    return buffer_len;
+}
+
+
+wad_file_class_t posix_wad_file = 
+{
+    W_POSIX_OpenFile,
+    W_POSIX_CloseFile,
+    W_POSIX_Read,
+};
+
+
+#endif /* #ifdef HAVE_MMAP */
+
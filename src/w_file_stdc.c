@@ -26,16 +26,48 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "m_misc.h"
 #include "w_file.h"
 #include "z_zone.h"
 
 
+// Small reads that carry on from the last one are served from a
+// read-ahead window, so runs of adjacent lumps (the lumps of a level,
+// or the sprites and patches read in lump order by R_PrecacheLevel)
+// cost a few reads instead of a seek and a read each.  The window
+// starts small and doubles with each refill while the run lasts, so
+// it is only as big as the run.  A read from anywhere else ends the
+// run: it is read on its own, and the window is freed, so a single
+// lump missing from the cache during play costs no more than before.
+//
+// The window is in the C heap rather than the zone, since the lump
+// loader thread reads through here too.
+
+#define READAHEAD_MIN (16 * 1024)
+#define READAHEAD_MAX (128 * 1024)
+
 typedef struct
 {
     wad_file_t wad;
     FILE *fstream;
+
+    // Position of the stream, so sequential reads skip the seek.
+
+    unsigned int filepos;
+
+    // The read-ahead window, and where in the file it starts.  The
+    // buffer is only allocated during a run.
+
+    byte *buffer;
+    unsigned int buffer_pos;
+    size_t buffer_len;
+
+    // Size of the next refill.
+
+    size_t readahead;
 } stdc_wad_file_t;
 
 extern wad_file_class_t stdc_wad_file;
@@ -59,6 +91,11 @@ static wad_file_t *W_StdC_OpenFile(char *path)
     result->wad.mapped = NULL;
     result->wad.length = M_FileLength(fstream);
     result->fstream = fstream;
+    result->filepos = 0;
+    result->buffer = NULL;
+    result->buffer_pos = 0;
+    result->buffer_len = 0;
+    result->readahead = READAHEAD_MIN;
 
     return &result->wad;
 }
@@ -70,9 +107,40 @@ static void W_StdC_CloseFile(wad_file_t *wad)
     stdc_wad = (stdc_wad_file_t *) wad;
 
     fclose(stdc_wad->fstream);
+    free(stdc_wad->buffer);
     Z_Free(stdc_wad);
 }
 
+// Read straight from the stream, seeking only if the last read
+// didn't leave it at offset.
+
+static size_t StreamRead(stdc_wad_file_t *stdc_wad, unsigned int offset,
+                         void *buffer, size_t buffer_len)
+{
+    size_t result;
+
+    if (offset != stdc_wad->filepos)
+    {
+        fseek(stdc_wad->fstream, offset, SEEK_SET);
+    }
+
+    result = fread(buffer, 1, buffer_len, stdc_wad->fstream);
+
+    stdc_wad->filepos = offset + result;
+
+    return result;
+}
+
+// Free the read-ahead window at the end of a run.
+
+static void EndRun(stdc_wad_file_t *stdc_wad)
+{
+    free(stdc_wad->buffer);
+    stdc_wad->buffer = NULL;
+    stdc_wad->buffer_len = 0;
+    stdc_wad->readahead = READAHEAD_MIN;
+}
+
 // Read data from the specified position in the file into the 
 // provided buffer.  Returns the number of bytes read.
 
@@ -80,19 +148,81 @@ size_t W_StdC_Read(wad_file_t *wad, unsigned int offset,
                    void *buffer, size_t buffer_len)
 {
     stdc_wad_file_t *stdc_wad;
-    size_t result;
+    unsigned int window_end;
+    size_t length;
+    boolean sequential;
 
     stdc_wad = (stdc_wad_file_t *) wad;
+    window_end = stdc_wad->buffer_pos + stdc_wad->buffer_len;
 
-    // Jump to the specified position in the file.
+    // Already in the read-ahead window?
 
-    fseek(stdc_wad->fstream, offset, SEEK_SET);
+    if (offset >= stdc_wad->buffer_pos
+     && offset + buffer_len <= window_end)
+    {
+        memcpy(buffer, stdc_wad->buffer + (offset - stdc_wad->buffer_pos),
+               buffer_len);
+        return buffer_len;
+    }
 
-    // Read into the buffer.
+    // Does it carry on from the last read?  Either it runs on from
+    // the window, or it starts at most a refill past where the stream
+    // is; reading across a small gap is cheaper than seeking.
 
-    result = fread(buffer, 1, buffer_len, stdc_wad->fstream);
+    sequential = (stdc_wad->buffer_len > 0
+               && offset >= stdc_wad->buffer_pos && offset <= window_end)
+              || (offset >= stdc_wad->filepos
+               && offset - stdc_wad->filepos < stdc_wad->readahead);
 
-    return result;
+    if (!sequential)
+    {
+        EndRun(stdc_wad);
+        return StreamRead(stdc_wad, offset, buffer, buffer_len);
+    }
+
+    // Big reads go straight into the buffer.
+
+    if (buffer_len >= READAHEAD_MAX / 2)
+    {
+        return StreamRead(stdc_wad, offset, buffer, buffer_len);
+    }
+
+    if (stdc_wad->buffer == NULL)
+    {
+        stdc_wad->buffer = malloc(READAHEAD_MAX);
+
+        if (stdc_wad->buffer == NULL)
+        {
+            return StreamRead(stdc_wad, offset, buffer, buffer_len);
+        }
+    }
+
+    // Move the window to start here, reading ahead of what was asked.
+
+    length = stdc_wad->readahead;
+
+    if (length < buffer_len)
+    {
+        length = buffer_len;
+    }
+
+    stdc_wad->buffer_pos = offset;
+    stdc_wad->buffer_len = StreamRead(stdc_wad, offset, stdc_wad->buffer,
+                                      length);
+
+    if (stdc_wad->readahead < READAHEAD_MAX)
+    {
+        stdc_wad->readahead *= 2;
+    }
+
+    if (buffer_len > stdc_wad->buffer_len)
+    {
+        buffer_len = stdc_wad->buffer_len;
+    }
+
+    memcpy(buffer, stdc_wad->buffer, buffer_len);
+
+    return buffer_len;
 }
 
 
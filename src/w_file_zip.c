@@ -0,0 +1,687 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2008 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+// DESCRIPTION:
+//        WAD I/O functions: ZIP and PK3 archives opened as a virtual PWAD.
+//
+//-----------------------------------------------------------------------------
+
+
+//
+// The archive is presented to W_AddFile as a PWAD that doesn't
+// exist on disk: a header, the data of every entry one after the
+// other, uncompressed, and a directory naming each entry after its
+// file name.  Entries under sprites/ and flats/ are put between
+// S_START/S_END and F_START/F_END markers, so the archive works like
+// a PWAD with those sections, with W_MergeFile too.
+//
+// Entries are inflated when they are read, a chunk of the archive at
+// a time.  W_ReadLump reads whole lumps, and those are inflated
+// straight into the zone block the lump cache has already set aside,
+// so nothing is allocated while reading and no lump is held twice.
+// Only an entry read a part at a time is inflated into a buffer of
+// its own, in the C heap, and just the last one is kept.
+//
+
+
+#include "config.h"
+
+#ifdef HAVE_LIBZ
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "c_io.h"
+#include "w_file.h"
+#include "z_zone.h"
+
+
+#define ZIP_END_OF_DIR          0x06054b50
+#define ZIP_DIR_ENTRY           0x02014b50
+#define ZIP_LOCAL_HEADER        0x04034b50
+
+#define ZIP_MAXCOMMENT          65535
+#define ZIP_INBUFSIZE           16384
+
+#define WAD_HEADER_SIZE         12
+#define WAD_DIRENTRY_SIZE       16
+
+typedef enum
+{
+    ZIP_NORMAL,
+    ZIP_SPRITES,
+    ZIP_FLATS,
+    NUM_ZIP_SECTIONS
+} zipsection_t;
+
+typedef struct
+{
+    char name[8];
+    zipsection_t section;
+
+    // Offset of the entry data in the virtual PWAD, and its size
+    // once inflated.
+
+    unsigned int position;
+    unsigned int size;
+
+    // Where the entry is in the archive, and how it is stored.
+
+    unsigned int header;
+    unsigned int csize;
+    int method;
+} zipentry_t;
+
+typedef struct
+{
+    wad_file_t wad;
+
+    // The archive file itself.
+
+    wad_file_t *archive;
+
+    // Entries, in the order of the virtual PWAD.
+
+    zipentry_t *entries;
+    int numentries;
+
+    // Header and directory of the virtual PWAD.
+
+    byte header[WAD_HEADER_SIZE];
+    byte *directory;
+    unsigned int diroffset;
+
+    // The last entry read a part at a time, inflated.
+
+    zipentry_t *partial_entry;
+    byte *partial;
+} zip_wad_file_t;
+
+extern wad_file_class_t stdc_wad_file;
+extern wad_file_class_t zip_wad_file;
+
+static byte inbuf[ZIP_INBUFSIZE];
+
+static unsigned int ReadLE16(byte *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int ReadLE32(byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static void WriteLE32(byte *p, unsigned int val)
+{
+    p[0] = val & 0xff;
+    p[1] = (val >> 8) & 0xff;
+    p[2] = (val >> 16) & 0xff;
+    p[3] = (val >> 24) & 0xff;
+}
+
+static boolean IsZipFile(char *path)
+{
+    size_t len = strlen(path);
+
+    return len > 4 && (!strcasecmp(path + len - 4, ".zip")
+                    || !strcasecmp(path + len - 4, ".pk3"));
+}
+
+// Find the end of central directory record, which is at the end of
+// the file behind a comment of up to 64K.
+
+static boolean FindEndOfDir(wad_file_t *archive, byte *end)
+{
+    byte *tail;
+    unsigned int taillen;
+    int i;
+
+    taillen = archive->length;
+
+    if (taillen > ZIP_MAXCOMMENT + 22)
+    {
+        taillen = ZIP_MAXCOMMENT + 22;
+    }
+
+    if (taillen < 22)
+    {
+        return false;
+    }
+
+    tail = Z_Malloc(taillen, PU_STATIC, 0);
+
+    if (W_Read(archive, archive->length - taillen, tail, taillen) != taillen)
+    {
+        Z_Free(tail);
+        return false;
+    }
+
+    for (i = taillen - 22; i >= 0; --i)
+    {
+        if (ReadLE32(tail + i) == ZIP_END_OF_DIR)
+        {
+            memcpy(end, tail + i, 22);
+            Z_Free(tail);
+            return true;
+        }
+    }
+
+    Z_Free(tail);
+    return false;
+}
+
+// Lump name for an entry: the base of its file name, upper case.
+
+static void EntryName(char *path, char *name)
+{
+    char *base;
+    int i;
+
+    base = strrchr(path, '/');
+    base = base != NULL ? base + 1 : path;
+
+    memset(name, 0, 8);
+
+    for (i=0; i<8 && base[i] != '\0' && base[i] != '.'; ++i)
+    {
+        name[i] = toupper(base[i]);
+    }
+}
+
+// Read the central directory into the entry list.  Returns the
+// number of entries.
+
+static int ReadEntries(zip_wad_file_t *zip, byte *end)
+{
+    byte *dir;
+    byte *p;
+    char path[256];
+    unsigned int dirsize;
+    unsigned int diroffset;
+    int numdir;
+    int namelen;
+    int flags;
+    int method;
+    int count;
+    int i;
+
+    numdir = ReadLE16(end + 10);
+    dirsize = ReadLE32(end + 12);
+    diroffset = ReadLE32(end + 16);
+
+    dir = Z_Malloc(dirsize, PU_STATIC, 0);
+
+    if (W_Read(zip->archive, diroffset, dir, dirsize) != dirsize)
+    {
+        Z_Free(dir);
+        return 0;
+    }
+
+    zip->entries = Z_Malloc(sizeof(zipentry_t) * numdir, PU_STATIC, 0);
+    count = 0;
+
+    for (i=0, p=dir; i<numdir; ++i)
+    {
+        if (p + 46 > dir + dirsize || ReadLE32(p) != ZIP_DIR_ENTRY)
+        {
+            break;
+        }
+
+        flags = ReadLE16(p + 8);
+        method = ReadLE16(p + 10);
+        namelen = ReadLE16(p + 28);
+
+        // The name, extra field and comment must be in the directory.
+
+        if (p + 46 + namelen + ReadLE16(p + 30) + ReadLE16(p + 32)
+          > dir + dirsize)
+        {
+            break;
+        }
+
+        if (namelen > sizeof(path) - 1)
+        {
+            namelen = sizeof(path) - 1;
+        }
+
+        memcpy(path, p + 46, namelen);
+        path[namelen] = '\0';
+
+        // Skip directories, and entries we can't unpack.
+
+        if (namelen > 0 && path[namelen - 1] != '/')
+        {
+            if ((flags & 1) != 0 || (method != 0 && method != Z_DEFLATED))
+            {
+                C_Printf(" W_Zip_OpenFile: can't unpack %s\n", path);
+            }
+            else
+            {
+                zipentry_t *entry = &zip->entries[count++];
+
+                EntryName(path, entry->name);
+
+                if (!strncasecmp(path, "sprites/", 8))
+                {
+                    entry->section = ZIP_SPRITES;
+                }
+                else if (!strncasecmp(path, "flats/", 6))
+                {
+                    entry->section = ZIP_FLATS;
+                }
+                else
+                {
+                    entry->section = ZIP_NORMAL;
+                }
+
+                entry->method = method;
+                entry->csize = ReadLE32(p + 20);
+                entry->size = ReadLE32(p + 24);
+                entry->header = ReadLE32(p + 42);
+            }
+        }
+
+        p += 46 + ReadLE16(p + 28) + ReadLE16(p + 30) + ReadLE16(p + 32);
+    }
+
+    Z_Free(dir);
+
+    return count;
+}
+
+static byte *AddDirEntry(byte *p, unsigned int position, unsigned int size,
+                         char *name)
+{
+    WriteLE32(p, position);
+    WriteLE32(p + 4, size);
+    memcpy(p + 8, name, 8);
+
+    return p + WAD_DIRENTRY_SIZE;
+}
+
+// Lay the entries out in the virtual PWAD, by section, and build its
+// header and directory.
+
+static void BuildDirectory(zip_wad_file_t *zip, int count)
+{
+    static char *markers[NUM_ZIP_SECTIONS][2] =
+    {
+        { NULL, NULL },
+        { "S_START", "S_END" },
+        { "F_START", "F_END" },
+    };
+    zipentry_t *sorted;
+    unsigned int position;
+    int numsection[NUM_ZIP_SECTIONS];
+    int numlumps;
+    char name[8];
+    byte *p;
+    int section;
+    int i, n;
+
+    memset(numsection, 0, sizeof(numsection));
+
+    for (i=0; i<count; ++i)
+    {
+        ++numsection[zip->entries[i].section];
+    }
+
+    numlumps = count;
+
+    for (section=ZIP_SPRITES; section<NUM_ZIP_SECTIONS; ++section)
+    {
+        if (numsection[section] > 0)
+        {
+            numlumps += 2;
+        }
+    }
+
+    sorted = Z_Malloc(sizeof(zipentry_t) * (count + 1), PU_STATIC, 0);
+    zip->directory = Z_Malloc(numlumps * WAD_DIRENTRY_SIZE, PU_STATIC, 0);
+
+    position = WAD_HEADER_SIZE;
+    p = zip->directory;
+    n = 0;
+
+    for (section=ZIP_NORMAL; section<NUM_ZIP_SECTIONS; ++section)
+    {
+        if (numsection[section] == 0)
+        {
+            continue;
+        }
+
+        if (markers[section][0] != NULL)
+        {
+            strncpy(name, markers[section][0], 8);
+            p = AddDirEntry(p, position, 0, name);
+        }
+
+        for (i=0; i<count; ++i)
+        {
+            if (zip->entries[i].section == section)
+            {
+                sorted[n] = zip->entries[i];
+                sorted[n].position = position;
+                p = AddDirEntry(p, position, sorted[n].size, sorted[n].name);
+                position += sorted[n].size;
+                ++n;
+            }
+        }
+
+        if (markers[section][1] != NULL)
+        {
+            strncpy(name, markers[section][1], 8);
+            p = AddDirEntry(p, position, 0, name);
+        }
+    }
+
+    Z_Free(zip->entries);
+    zip->entries = sorted;
+    zip->numentries = count;
+
+    zip->diroffset = position;
+
+    memcpy(zip->header, "PWAD", 4);
+    WriteLE32(zip->header + 4, numlumps);
+    WriteLE32(zip->header + 8, zip->diroffset);
+
+    zip->wad.length = zip->diroffset + numlumps * WAD_DIRENTRY_SIZE;
+}
+
+static wad_file_t *W_Zip_OpenFile(char *path)
+{
+    zip_wad_file_t *result;
+    wad_file_t *archive;
+    byte end[22];
+    int count;
+
+    if (!IsZipFile(path))
+    {
+        return NULL;
+    }
+
+    archive = stdc_wad_file.OpenFile(path);
+
+    if (archive == NULL)
+    {
+        return NULL;
+    }
+
+    if (!FindEndOfDir(archive, end))
+    {
+        C_Printf(" W_Zip_OpenFile: %s is not a zip file\n", path);
+        W_CloseFile(archive);
+        return NULL;
+    }
+
+    // Create a new zip_wad_file_t to hold the archive and directory.
+
+    result = Z_Malloc(sizeof(zip_wad_file_t), PU_STATIC, 0);
+    result->wad.file_class = &zip_wad_file;
+    result->wad.mapped = NULL;
+    result->archive = archive;
+    result->partial_entry = NULL;
+    result->partial = NULL;
+
+    count = ReadEntries(result, end);
+    BuildDirectory(result, count);
+
+    return &result->wad;
+}
+
+static void W_Zip_CloseFile(wad_file_t *wad)
+{
+    zip_wad_file_t *zip;
+
+    zip = (zip_wad_file_t *) wad;
+
+    free(zip->partial);
+    W_CloseFile(zip->archive);
+    Z_Free(zip->entries);
+    Z_Free(zip->directory);
+    Z_Free(zip);
+}
+
+// Inflate an entry into dest, reading the archive a chunk at a time.
+
+static boolean InflateEntry(zip_wad_file_t *zip, zipentry_t *entry,
+                            byte *dest)
+{
+    byte local[30];
+    unsigned int pos;
+    unsigned int remaining;
+    unsigned int len;
+    z_stream stream;
+    int ret;
+
+    if (W_Read(zip->archive, entry->header, local, 30) != 30
+     || ReadLE32(local) != ZIP_LOCAL_HEADER)
+    {
+        return false;
+    }
+
+    pos = entry->header + 30 + ReadLE16(local + 26) + ReadLE16(local + 28);
+
+    if (entry->method == 0)
+    {
+        return W_Read(zip->archive, pos, dest, entry->size) == entry->size;
+    }
+
+    memset(&stream, 0, sizeof(stream));
+
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    {
+        return false;
+    }
+
+    stream.next_out = dest;
+    stream.avail_out = entry->size;
+    remaining = entry->csize;
+
+    do
+    {
+        if (stream.avail_in == 0 && remaining > 0)
+        {
+            len = remaining < ZIP_INBUFSIZE ? remaining : ZIP_INBUFSIZE;
+
+            if (W_Read(zip->archive, pos, inbuf, len) != len)
+            {
+                break;
+            }
+
+            pos += len;
+            remaining -= len;
+
+            stream.next_in = inbuf;
+            stream.avail_in = len;
+        }
+
+        ret = inflate(&stream, Z_NO_FLUSH);
+    } while (ret == Z_OK);
+
+    inflateEnd(&stream);
+
+    return ret == Z_STREAM_END && stream.total_out == entry->size;
+}
+
+// Get the inflated data of an entry being read a part at a time.
+
+static byte *PartialEntry(zip_wad_file_t *zip, zipentry_t *entry)
+{
+    if (zip->partial_entry == entry)
+    {
+        return zip->partial;
+    }
+
+    free(zip->partial);
+    zip->partial_entry = NULL;
+    zip->partial = malloc(entry->size);
+
+    if (zip->partial == NULL)
+    {
+        return NULL;
+    }
+
+    if (!InflateEntry(zip, entry, zip->partial))
+    {
+        C_Printf(" W_Zip_Read: failed to inflate %.8s\n", entry->name);
+        free(zip->partial);
+        zip->partial = NULL;
+        return NULL;
+    }
+
+    zip->partial_entry = entry;
+
+    return zip->partial;
+}
+
+// Find the entry holding an offset in the virtual PWAD.
+
+static zipentry_t *FindEntry(zip_wad_file_t *zip, unsigned int offset)
+{
+    int lo, hi, mid;
+
+    lo = 0;
+    hi = zip->numentries - 1;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi + 1) / 2;
+
+        if (zip->entries[mid].position <= offset)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    if (hi < 0 || offset < zip->entries[lo].position
+     || offset >= zip->entries[lo].position + zip->entries[lo].size)
+    {
+        return NULL;
+    }
+
+    return &zip->entries[lo];
+}
+
+// Read data from the specified position in the file into the 
+// provided buffer.  Returns the number of bytes read.
+
+static size_t W_Zip_Read(wad_file_t *wad, unsigned int offset,
+                         void *buffer, size_t buffer_len)
+{
+    zip_wad_file_t *zip;
+    zipentry_t *entry;
+    byte *dest;
+    byte *data;
+    size_t result;
+    size_t len;
+
+    zip = (zip_wad_file_t *) wad;
+    dest = buffer;
+    result = 0;
+
+    while (buffer_len > 0 && offset < zip->wad.length)
+    {
+        if (offset < WAD_HEADER_SIZE)
+        {
+            len = WAD_HEADER_SIZE - offset;
+            data = zip->header + offset;
+        }
+        else if (offset >= zip->diroffset)
+        {
+            len = zip->wad.length - offset;
+            data = zip->directory + (offset - zip->diroffset);
+        }
+        else
+        {
+            entry = FindEntry(zip, offset);
+
+            if (entry == NULL)
+            {
+                break;
+            }
+
+            len = entry->position + entry->size - offset;
+
+            if (offset == entry->position && buffer_len >= entry->size)
+            {
+                // The whole entry: inflate it straight into place.
+
+                if (!InflateEntry(zip, entry, dest))
+                {
+                    C_Printf(" W_Zip_Read: failed to inflate %.8s\n",
+                             entry->name);
+                    break;
+                }
+
+                data = NULL;
+            }
+            else
+            {
+                data = PartialEntry(zip, entry);
+
+                if (data == NULL)
+                {
+                    break;
+                }
+
+                data += offset - entry->position;
+            }
+        }
+
+        if (len > buffer_len)
+        {
+            len = buffer_len;
+        }
+
+        if (data != NULL)
+        {
+            memcpy(dest, data, len);
+        }
+
+        dest += len;
+        offset += len;
+        buffer_len -= len;
+        result += len;
+    }
+
+    return result;
+}
+
+
+wad_file_class_t zip_wad_file = 
+{
+    W_Zip_OpenFile,
+    W_Zip_CloseFile,
+    W_Zip_Read,
+};
+
+
+#endif /* #ifdef HAVE_LIBZ */
+
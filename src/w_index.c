@@ -0,0 +1,335 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+// DESCRIPTION:
+//       Lump index cache.
+//
+//       The WAD directories read by W_AddFile and the results of
+//       W_MergeFile are saved to a file between runs, so that the
+//       next run can take them from one small sequential read
+//       instead of seeking to the end of every WAD and merging the
+//       sprite and flat lists again.
+//
+//       Each record is keyed by a SHA-1: of the file name, size and
+//       modification time for a directory, and of the lump directory
+//       being merged (W_Checksum) for a merge.  Records not used by
+//       a run are dropped when the index is written back.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "c_io.h"
+#include "m_misc.h"
+#include "w_index.h"
+#include "z_zone.h"
+
+
+#define INDEX_MAGIC             0x58444957      // in native byte order
+#define INDEX_VERSION           1
+#define MAXINDEXRECORDS         64
+
+typedef struct
+{
+    sha1_digest_t key;
+    int type;
+    int length;
+
+    // Followed by length bytes of data, padded to a multiple of 4.
+
+} indexrecord_t;
+
+typedef struct
+{
+    indexrecord_t *record;
+
+    // Looked up or stored during this run.
+
+    boolean used;
+} indexentry_t;
+
+extern boolean usb;
+extern boolean sd;
+
+static indexentry_t index_entries[MAXINDEXRECORDS];
+static int num_index_entries = 0;
+static boolean index_loaded = false;
+static boolean index_changed = false;
+
+
+static char *IndexPath(void)
+{
+    if (usb)
+    {
+        return "usb:/apps/wiidoom/lumpindex.dat";
+    }
+    else if (sd)
+    {
+        return "sd:/apps/wiidoom/lumpindex.dat";
+    }
+
+    return NULL;
+}
+
+static int RecordSize(int length)
+{
+    return sizeof(indexrecord_t) + ((length + 3) & ~3);
+}
+
+// Read the index file, if there is one, and split it into records.
+
+static void LoadIndex(void)
+{
+    indexrecord_t *record;
+    char *path;
+    FILE *fstream;
+    byte *data;
+    int header[3];
+    int length;
+    int offset;
+
+    index_loaded = true;
+
+    path = IndexPath();
+
+    if (path == NULL)
+    {
+        return;
+    }
+
+    fstream = fopen(path, "rb");
+
+    if (fstream == NULL)
+    {
+        return;
+    }
+
+    length = M_FileLength(fstream) - sizeof(header);
+
+    if (length < 0
+     || fread(header, 1, sizeof(header), fstream) != sizeof(header)
+     || header[0] != INDEX_MAGIC
+     || header[1] != INDEX_VERSION)
+    {
+        // Not an index we understand; it gets replaced.
+
+        fclose(fstream);
+        index_changed = true;
+        return;
+    }
+
+    data = Z_Malloc(length, PU_STATIC, 0);
+
+    if (fread(data, 1, length, fstream) != length)
+    {
+        length = 0;
+    }
+
+    fclose(fstream);
+
+    for (offset = 0;
+         offset + sizeof(indexrecord_t) <= length
+      && num_index_entries < MAXINDEXRECORDS;
+         offset += RecordSize(record->length))
+    {
+        record = (indexrecord_t *) (data + offset);
+
+        if (record->length < 0
+         || offset + RecordSize(record->length) > length)
+        {
+            index_changed = true;
+            break;
+        }
+
+        index_entries[num_index_entries].record = record;
+        index_entries[num_index_entries].used = false;
+        ++num_index_entries;
+    }
+}
+
+static indexentry_t *FindEntry(indextype_t type, sha1_digest_t key)
+{
+    int i;
+
+    if (!index_loaded)
+    {
+        LoadIndex();
+    }
+
+    for (i=0; i<num_index_entries; ++i)
+    {
+        if (index_entries[i].record->type == type
+         && !memcmp(index_entries[i].record->key, key, sizeof(sha1_digest_t)))
+        {
+            return &index_entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+//
+// W_IndexFileKey
+// Generate the key for a file from its name, size and modification
+// time.  Returns false if the file can't be stat()ed.
+//
+
+boolean W_IndexFileKey(char *filename, sha1_digest_t key)
+{
+    sha1_context_t sha1_context;
+    struct stat st;
+
+    if (stat(filename, &st) != 0)
+    {
+        return false;
+    }
+
+    SHA1_Init(&sha1_context);
+    SHA1_UpdateString(&sha1_context, filename);
+    SHA1_UpdateInt32(&sha1_context, st.st_size);
+    SHA1_UpdateInt32(&sha1_context, st.st_mtime);
+    SHA1_Final(key, &sha1_context);
+
+    return true;
+}
+
+//
+// W_IndexLookup
+// Find the record for a key.  The data stays valid for the rest of
+// the run.
+//
+
+boolean W_IndexLookup(indextype_t type, sha1_digest_t key,
+                      void **data, int *length)
+{
+    indexentry_t *entry;
+
+    entry = FindEntry(type, key);
+
+    if (entry == NULL)
+    {
+        return false;
+    }
+
+    entry->used = true;
+
+    *data = entry->record + 1;
+    *length = entry->record->length;
+
+    return true;
+}
+
+//
+// W_IndexStore
+// Add a record, or replace the one with the same key.  The data is
+// copied.
+//
+
+void W_IndexStore(indextype_t type, sha1_digest_t key,
+                  void *data, int length)
+{
+    indexentry_t *entry;
+    indexrecord_t *record;
+
+    entry = FindEntry(type, key);
+
+    if (entry == NULL)
+    {
+        if (num_index_entries >= MAXINDEXRECORDS)
+        {
+            return;
+        }
+
+        entry = &index_entries[num_index_entries];
+        ++num_index_entries;
+    }
+
+    record = Z_Malloc(RecordSize(length), PU_STATIC, 0);
+    memset(record, 0, RecordSize(length));
+    memcpy(record->key, key, sizeof(sha1_digest_t));
+    record->type = type;
+    record->length = length;
+    memcpy(record + 1, data, length);
+
+    entry->record = record;
+    entry->used = true;
+
+    index_changed = true;
+}
+
+//
+// W_SaveIndex
+// Write the records used during this run back to the index file,
+// if they differ from what was loaded.
+//
+
+void W_SaveIndex(void)
+{
+    char *path;
+    FILE *fstream;
+    int header[3];
+    int i;
+
+    for (i=0; i<num_index_entries; ++i)
+    {
+        if (!index_entries[i].used)
+        {
+            index_changed = true;
+        }
+    }
+
+    path = IndexPath();
+
+    if (!index_changed || path == NULL)
+    {
+        return;
+    }
+
+    fstream = fopen(path, "wb");
+
+    if (fstream == NULL)
+    {
+        C_Printf(" W_SaveIndex: couldn't write %s\n", path);
+        return;
+    }
+
+    header[0] = INDEX_MAGIC;
+    header[1] = INDEX_VERSION;
+    header[2] = 0;
+
+    fwrite(header, 1, sizeof(header), fstream);
+
+    for (i=0; i<num_index_entries; ++i)
+    {
+        if (index_entries[i].used)
+        {
+            fwrite(index_entries[i].record, 1,
+                   RecordSize(index_entries[i].record->length), fstream);
+        }
+    }
+
+    fclose(fstream);
+
+    index_changed = false;
+}
+
@@ -0,0 +1,50 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+// DESCRIPTION:
+//       Lump index cache: WAD directories and merge results saved
+//       between runs.
+//
+
+#ifndef W_INDEX_H
+#define W_INDEX_H
+
+#include "doomtype.h"
+#include "sha1.h"
+
+// Types of index record.
+
+typedef enum
+{
+    INDEX_DIRECTORY = 1,        // WAD header and directory, as on disk
+    INDEX_MERGE,                // lumpinfo sources after W_MergeFile
+    INDEX_FINGERPRINTS,         // lump content fingerprints, for -dedup
+} indextype_t;
+
+boolean W_IndexFileKey(char *filename, sha1_digest_t key);
+boolean W_IndexLookup(indextype_t type, sha1_digest_t key,
+                      void **data, int *length);
+void W_IndexStore(indextype_t type, sha1_digest_t key,
+                  void *data, int length);
+void W_SaveIndex(void);
+
+#endif /* #ifndef W_INDEX_H */
+
@@ -28,6 +28,9 @@
 #include "i_system.h"
 #include "i_timer.h"
 #include "m_misc.h"
+#include "sha1.h"
+#include "w_checksum.h"
+#include "w_index.h"
 #include "w_merge.h"
 #include "w_wad.h"
 #include "z_zone.h"
@@ -66,6 +69,20 @@ static sprite_frame_t *sprite_frames;
 static int num_sprite_frames;
 static int sprite_frames_alloced;
 
+// open addressed hash of sprite_frames indexes, keyed on (name, frame);
+// always at least twice the size of sprite_frames so probes stay short
+static int *sprite_hash;
+static unsigned int sprite_hash_mask;
+
+// hash of pwad_flats names, so that each IWAD flat is checked in
+// constant time rather than by scanning the PWAD's flats section
+static int *flat_hash;
+static unsigned int flat_hash_mask;
+
+// the merged directory, as indexes into lumpinfo
+static int *merge_sources;
+static int num_merge_sources;
+
 // Search in a list to find a lump with a particular name
 // Linear search (slow!)
 //
@@ -84,6 +101,71 @@ static int FindInList(searchlist_t *list, char *name)
     return -1;
 }
 
+// Hash of the 8 character lump name, using the key from the main
+// lump hash table
+
+static unsigned int FlatHash(char *name)
+{
+    uint64_t key = W_LumpNameKey(name);
+
+    return (unsigned int) (key ^ (key >> 32)) * 2654435761U;
+}
+
+// Build a hash table of the PWAD's flats, to be used by FindFlat
+
+static void GenerateFlatHash(void)
+{
+    unsigned int size;
+    unsigned int slot;
+    int i;
+
+    for (size = 16; size < (unsigned int) pwad_flats.numlumps * 2; size <<= 1);
+
+    flat_hash = Z_Malloc(sizeof(*flat_hash) * size, PU_STATIC, NULL);
+    flat_hash_mask = size - 1;
+
+    for (i=0; i<(int) size; ++i)
+    {
+        flat_hash[i] = -1;
+    }
+
+    for (i=0; i<pwad_flats.numlumps; ++i)
+    {
+        slot = FlatHash(pwad_flats.lumps[i].name) & flat_hash_mask;
+
+        while (flat_hash[slot] >= 0)
+        {
+            slot = (slot + 1) & flat_hash_mask;
+        }
+
+        flat_hash[slot] = i;
+    }
+}
+
+// Find a flat in the PWAD by name
+//
+// Returns -1 if not found
+
+static int FindFlat(char *name)
+{
+    unsigned int slot;
+    int i;
+
+    slot = FlatHash(name) & flat_hash_mask;
+
+    while ((i = flat_hash[slot]) >= 0)
+    {
+        if (!strncasecmp(pwad_flats.lumps[i].name, name, 8))
+        {
+            return i;
+        }
+
+        slot = (slot + 1) & flat_hash_mask;
+    }
+
+    return -1;
+}
+
 static boolean SetupList(searchlist_t *list, searchlist_t *src_list,
                          char *startname, char *endname,
                          char *startname2, char *endname2)
@@ -141,6 +223,66 @@ static void SetupLists(void)
     SetupList(&pwad_sprites, &pwad, "S_START", "S_END", "SS_START", "SS_END");
 }
 
+// Hash of a sprite name (case insensitive) and frame
+
+static unsigned int SpriteFrameHash(char *name, int frame)
+{
+    unsigned int result = 0;
+    int i;
+
+    for (i=0; i<4; ++i)
+    {
+        result = (result << 8) | toupper((unsigned char) name[i]);
+    }
+
+    return (result ^ ((unsigned int) frame << 5)) * 2654435761U;
+}
+
+// Insert a sprite_frames index into the hash table
+
+static void HashSpriteFrame(int index)
+{
+    sprite_frame_t *frame = &sprite_frames[index];
+    unsigned int slot;
+
+    slot = SpriteFrameHash(frame->sprname, frame->frame) & sprite_hash_mask;
+
+    while (sprite_hash[slot] >= 0)
+    {
+        slot = (slot + 1) & sprite_hash_mask;
+    }
+
+    sprite_hash[slot] = index;
+}
+
+// (Re)allocate the sprite frame hash table to suit sprite_frames_alloced,
+// and fill it with the frames already in the list
+
+static void AllocSpriteHash(void)
+{
+    unsigned int size;
+    int i;
+
+    if (sprite_hash != NULL)
+    {
+        Z_Free(sprite_hash);
+    }
+
+    size = sprite_frames_alloced * 2;
+    sprite_hash = Z_Malloc(sizeof(*sprite_hash) * size, PU_STATIC, NULL);
+    sprite_hash_mask = size - 1;
+
+    for (i=0; i<(int) size; ++i)
+    {
+        sprite_hash[i] = -1;
+    }
+
+    for (i=0; i<num_sprite_frames; ++i)
+    {
+        HashSpriteFrame(i);
+    }
+}
+
 // Initialize the replace list
 
 static void InitSpriteList(void)
@@ -153,6 +295,8 @@ static void InitSpriteList(void)
     }
 
     num_sprite_frames = 0;
+
+    AllocSpriteHash();
 }
 
 #pragma GCC diagnostic push
@@ -188,11 +332,14 @@ static boolean ValidSpriteLumpName(char *name)
 static sprite_frame_t *FindSpriteFrame(char *name, int frame)
 {
     sprite_frame_t *result;
+    unsigned int slot;
     int i;
 
-    // Search the list and try to find the frame
+    // Look up the frame in the hash table
 
-    for (i=0; i<num_sprite_frames; ++i)
+    slot = SpriteFrameHash(name, frame) & sprite_hash_mask;
+
+    while ((i = sprite_hash[slot]) >= 0)
     {
         sprite_frame_t *cur = &sprite_frames[i];
 
@@ -200,6 +347,8 @@ static sprite_frame_t *FindSpriteFrame(char *name, int frame)
         {
             return cur;
         }
+
+        slot = (slot + 1) & sprite_hash_mask;
     }
 
     // Not found in list; Need to add to the list
@@ -217,6 +366,8 @@ static sprite_frame_t *FindSpriteFrame(char *name, int frame)
         Z_Free(sprite_frames);
         sprite_frames_alloced *= 2;
         sprite_frames = newframes;
+
+        AllocSpriteHash();
     }
 
     // Add to end of list
@@ -228,6 +379,8 @@ static sprite_frame_t *FindSpriteFrame(char *name, int frame)
     for (i=0; i<8; ++i)
         result->angle_lumps[i] = NULL;
 
+    HashSpriteFrame(num_sprite_frames);
+
     ++num_sprite_frames;
 
     return result;
@@ -389,17 +542,22 @@ static void GenerateSpriteList(void)
 //  * All Sprites and Flats are ignored, with the assumption they have 
 //    already been merged into the IWAD's sections.
 
+// Add a lump to the merged directory
+
+static void AddLump(lumpinfo_t *lump)
+{
+    merge_sources[num_merge_sources++] = lump - lumpinfo;
+}
+
 static void DoMerge(void)
 {
     section_t current_section;
-    lumpinfo_t *newlumps;
-    int num_newlumps;
     int lumpindex;
     int i, n;
     
     // Can't ever have more lumps than we already have
-    newlumps = malloc(sizeof(lumpinfo_t) * numlumps);
-    num_newlumps = 0;
+    merge_sources = malloc(sizeof(int) * numlumps);
+    num_merge_sources = 0;
 
     // Add IWAD lumps
     current_section = SECTION_NORMAL;
@@ -420,7 +578,7 @@ static void DoMerge(void)
                     current_section = SECTION_SPRITES;
                 }
 
-                newlumps[num_newlumps++] = *lump;
+                AddLump(lump);
 
                 break;
 
@@ -435,10 +593,10 @@ static void DoMerge(void)
 
                     for (n=0; n<pwad_flats.numlumps; ++n)
                     {
-                        newlumps[num_newlumps++] = pwad_flats.lumps[n];
+                        AddLump(&pwad_flats.lumps[n]);
                     }
 
-                    newlumps[num_newlumps++] = *lump;
+                    AddLump(lump);
 
                     // back to normal reading
                     current_section = SECTION_NORMAL;
@@ -450,11 +608,11 @@ static void DoMerge(void)
                     // end of the section. Otherwise, if it is only in the
                     // IWAD, add it now
 
-                    lumpindex = FindInList(&pwad_flats, lump->name);
+                    lumpindex = FindFlat(lump->name);
 
                     if (lumpindex < 0)
                     {
-                        newlumps[num_newlumps++] = *lump;
+                        AddLump(lump);
                     }
                 }
 
@@ -472,12 +630,12 @@ static void DoMerge(void)
                     {
                         if (SpriteLumpNeeded(&pwad_sprites.lumps[n]))
                         {
-                            newlumps[num_newlumps++] = pwad_sprites.lumps[n];
+                            AddLump(&pwad_sprites.lumps[n]);
                         }
                     }
 
                     // copy the ending
-                    newlumps[num_newlumps++] = *lump;
+                    AddLump(lump);
 
                     // back to normal reading
                     current_section = SECTION_NORMAL;
@@ -489,7 +647,7 @@ static void DoMerge(void)
 
                     if (SpriteLumpNeeded(lump))
                     {
-                        newlumps[num_newlumps++] = *lump;
+                        AddLump(lump);
                     }
                 }
 
@@ -521,7 +679,7 @@ static void DoMerge(void)
                 {
                     // Don't include the headers of sections
        
-                    newlumps[num_newlumps++] = *lump;
+                    AddLump(lump);
                 }
                 break;
 
@@ -551,12 +709,47 @@ static void DoMerge(void)
         }
     }
 
-    // Switch to the new lumpinfo, and free the old one
+}
+
+// Switch to the merged lumpinfo, and free the old one
+
+static void ApplyMerge(int *sources, int num_sources)
+{
+    lumpinfo_t *newlumps;
+    int i;
+
+    newlumps = malloc(sizeof(lumpinfo_t) * num_sources);
+
+    for (i=0; i<num_sources; ++i)
+    {
+        newlumps[i] = lumpinfo[sources[i]];
+
+        // Aliases are lump numbers, so have to be found again for the
+        // new order; W_ResolveAliases does that
+
+        newlumps[i].alias = -1;
+    }
 
     free(lumpinfo);
     lumpinfo = newlumps;
-    numlumps = num_newlumps;
+    numlumps = num_sources;
+}
+
+// Check a merge from the lump index fits the current directory
+
+static boolean ValidSources(int *sources, int num_sources)
+{
+    int i;
+
+    for (i=0; i<num_sources; ++i)
+    {
+        if (sources[i] < 0 || sources[i] >= numlumps)
+        {
+            return false;
+        }
+    }
 
+    return true;
 }
 
 void W_PrintDirectory(void)
@@ -578,6 +771,9 @@ void W_PrintDirectory(void)
 void W_MergeFile(char *filename, boolean automatic)
 {
     int old_numlumps;
+    sha1_digest_t key;
+    void *cached;
+    int length;
 
     old_numlumps = numlumps;
 
@@ -586,6 +782,18 @@ void W_MergeFile(char *filename, boolean automatic)
     if (W_AddFile(filename, automatic) == NULL)
         return;
 
+    // The merge depends only on the directory, so if this one has
+    // been merged before, take the result from the lump index
+
+    W_Checksum(key);
+
+    if (W_IndexLookup(INDEX_MERGE, key, &cached, &length)
+     && ValidSources(cached, length / sizeof(int)))
+    {
+        ApplyMerge(cached, length / sizeof(int));
+        return;
+    }
+
     // iwad is at the start, pwad was appended to the end
 
     iwad.lumps = lumpinfo;
@@ -604,6 +812,19 @@ void W_MergeFile(char *filename, boolean automatic)
 
     // Perform the merge
 
+    GenerateFlatHash();
+
     DoMerge();
+
+    Z_Free(flat_hash);
+    flat_hash = NULL;
+
+    W_IndexStore(INDEX_MERGE, key, merge_sources,
+                 num_merge_sources * sizeof(int));
+
+    ApplyMerge(merge_sources, num_merge_sources);
+
+    free(merge_sources);
+    merge_sources = NULL;
 }
 
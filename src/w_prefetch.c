@@ -0,0 +1,385 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+// DESCRIPTION:
+//       Background lump loading ahead of level setup.
+//
+//       Lumps the next level will need are queued as soon as the map
+//       is known, and a loader thread reads them while the player is
+//       still looking at the intermission or the level is being set
+//       up.  When W_ReadLump wants one of them it is copied from the
+//       loader's buffer; only lumps still being read are waited for,
+//       and lumps not yet started are read directly as before.
+//
+//       The zone is not thread safe, so the loader thread never
+//       touches it: lump data is read into the C heap and copied into
+//       the zone block by the main thread.  Reads from a WAD file are
+//       serialized with W_PrefetchLock, since the stdio file class
+//       keeps a read-ahead window per file.
+//
+
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_io.h"
+#include "i_timer.h"
+#include "w_file.h"
+#include "w_prefetch.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+
+// Most lump data held by the loader thread at once.  Lumps queued past
+// this are left for the main thread to read.
+
+#define PREFETCH_BUDGET         (4 * 1024 * 1024)
+
+typedef enum
+{
+    PREFETCH_NONE,
+    PREFETCH_QUEUED,
+    PREFETCH_READING,
+    PREFETCH_READY,
+} prefetchstate_t;
+
+extern wad_file_class_t stdc_wad_file;
+
+static SDL_Thread *prefetch_thread = NULL;
+
+// The prefetch mutex is held while the queue or the lump states are
+// being accessed.  queue_cond is signalled when a lump is queued, and
+// ready_cond when the loader has finished with one.
+
+static SDL_mutex *prefetch_mutex;
+static SDL_cond *queue_cond;
+static SDL_cond *ready_cond;
+
+// The file mutex is held while reading from a WAD file.
+
+static SDL_mutex *file_mutex;
+
+// State and data of each lump, indexed by lump number.
+
+static byte *lumpstate;
+static byte **lumpdata;
+static int prefetch_bytes;
+
+// Ring of queued lump numbers, numlumps long.
+
+static int *queue;
+static int queue_head;
+static int queue_length;
+
+// Since W_PrefetchResetStats
+
+static int lumps_ready;
+static int lumps_waited;
+static int lumps_missed;
+static int stall_time;
+
+// Free the data of a lump read by the loader.  The prefetch mutex
+// must be held.
+
+static void FreeLump(int lump)
+{
+    free(lumpdata[lump]);
+    lumpdata[lump] = NULL;
+    lumpstate[lump] = PREFETCH_NONE;
+    prefetch_bytes -= lumpinfo[lump].size;
+}
+
+static int PrefetchThread(void *unused)
+{
+    lumpinfo_t *l;
+    byte *data;
+    int lump;
+
+    SDL_LockMutex(prefetch_mutex);
+
+    for (;;)
+    {
+        while (queue_length == 0)
+        {
+            SDL_CondWait(queue_cond, prefetch_mutex);
+        }
+
+        lump = queue[queue_head];
+        queue_head = (queue_head + 1) % numlumps;
+        --queue_length;
+
+        // Claimed by the main thread, or dropped, since it was queued?
+
+        if (lumpstate[lump] != PREFETCH_QUEUED)
+        {
+            continue;
+        }
+
+        l = &lumpinfo[lump];
+
+        if (prefetch_bytes + l->size > PREFETCH_BUDGET)
+        {
+            lumpstate[lump] = PREFETCH_NONE;
+            continue;
+        }
+
+        lumpstate[lump] = PREFETCH_READING;
+        prefetch_bytes += l->size;
+
+        SDL_UnlockMutex(prefetch_mutex);
+
+        data = malloc(l->size);
+
+        if (data != NULL)
+        {
+            SDL_LockMutex(file_mutex);
+
+            if (W_Read(l->wad_file, l->position, data, l->size)
+              < (size_t) l->size)
+            {
+                free(data);
+                data = NULL;
+            }
+
+            SDL_UnlockMutex(file_mutex);
+        }
+
+        SDL_LockMutex(prefetch_mutex);
+
+        lumpdata[lump] = data;
+
+        if (data != NULL)
+        {
+            lumpstate[lump] = PREFETCH_READY;
+        }
+        else
+        {
+            FreeLump(lump);
+        }
+
+        SDL_CondBroadcast(ready_cond);
+    }
+
+    return 0;
+}
+
+void W_PrefetchInit(void)
+{
+    lumpstate = Z_Malloc(numlumps, PU_STATIC, NULL);
+    memset(lumpstate, PREFETCH_NONE, numlumps);
+
+    lumpdata = Z_Malloc(numlumps * sizeof(*lumpdata), PU_STATIC, NULL);
+    memset(lumpdata, 0, numlumps * sizeof(*lumpdata));
+
+    queue = Z_Malloc(numlumps * sizeof(*queue), PU_STATIC, NULL);
+    queue_head = 0;
+    queue_length = 0;
+
+    prefetch_mutex = SDL_CreateMutex();
+    file_mutex = SDL_CreateMutex();
+    queue_cond = SDL_CreateCond();
+    ready_cond = SDL_CreateCond();
+
+    // If the thread can't be started, everything is read by the main
+    // thread as before.
+
+    prefetch_thread = SDL_CreateThread(PrefetchThread, NULL);
+}
+
+void W_PrefetchLump(int lump)
+{
+    lumpinfo_t *l;
+
+    if (prefetch_thread == NULL)
+    {
+        return;
+    }
+
+    // The cache entry of a lump with the same contents is used instead
+
+    if (lumpinfo[lump].alias >= 0)
+    {
+        lump = lumpinfo[lump].alias;
+    }
+
+    l = &lumpinfo[lump];
+
+    // Already in memory, or in a file the loader can't read from?
+    // The zip file class inflates through one buffer shared by all
+    // archives, so only plain WAD files are read by the loader.
+
+    if (l->cache != NULL || l->size <= 0
+     || l->wad_file->file_class != &stdc_wad_file)
+    {
+        return;
+    }
+
+    SDL_LockMutex(prefetch_mutex);
+
+    if (lumpstate[lump] == PREFETCH_NONE && queue_length < numlumps)
+    {
+        queue[(queue_head + queue_length) % numlumps] = lump;
+        ++queue_length;
+        lumpstate[lump] = PREFETCH_QUEUED;
+
+        SDL_CondSignal(queue_cond);
+    }
+
+    SDL_UnlockMutex(prefetch_mutex);
+}
+
+boolean W_PrefetchPending(int lump)
+{
+    boolean result;
+
+    if (prefetch_thread == NULL)
+    {
+        return false;
+    }
+
+    SDL_LockMutex(prefetch_mutex);
+    result = lumpstate[lump] == PREFETCH_QUEUED
+          || lumpstate[lump] == PREFETCH_READING;
+    SDL_UnlockMutex(prefetch_mutex);
+
+    return result;
+}
+
+boolean W_PrefetchClaim(unsigned int lump, void *dest)
+{
+    boolean result = false;
+    int starttime;
+
+    if (prefetch_thread == NULL)
+    {
+        return false;
+    }
+
+    SDL_LockMutex(prefetch_mutex);
+
+    switch (lumpstate[lump])
+    {
+        case PREFETCH_QUEUED:
+
+            // Not started yet: reading it now is quicker than waiting
+            // for everything ahead of it in the queue.
+
+            lumpstate[lump] = PREFETCH_NONE;
+            ++lumps_missed;
+            break;
+
+        case PREFETCH_READING:
+            starttime = I_GetTimeMS();
+
+            while (lumpstate[lump] == PREFETCH_READING)
+            {
+                SDL_CondWait(ready_cond, prefetch_mutex);
+            }
+
+            stall_time += I_GetTimeMS() - starttime;
+            ++lumps_waited;
+            break;
+
+        case PREFETCH_READY:
+            ++lumps_ready;
+            break;
+
+        default:
+            break;
+    }
+
+    if (lumpstate[lump] == PREFETCH_READY)
+    {
+        memcpy(dest, lumpdata[lump], lumpinfo[lump].size);
+        FreeLump(lump);
+        result = true;
+    }
+
+    SDL_UnlockMutex(prefetch_mutex);
+
+    return result;
+}
+
+void W_PrefetchLock(void)
+{
+    if (file_mutex != NULL)
+    {
+        SDL_LockMutex(file_mutex);
+    }
+}
+
+void W_PrefetchUnlock(void)
+{
+    if (file_mutex != NULL)
+    {
+        SDL_UnlockMutex(file_mutex);
+    }
+}
+
+void W_PrefetchStall(int ms)
+{
+    stall_time += ms;
+}
+
+void W_PrefetchResetStats(void)
+{
+    lumps_ready = 0;
+    lumps_waited = 0;
+    lumps_missed = 0;
+    stall_time = 0;
+}
+
+void W_PrefetchFinish(void)
+{
+    unsigned int i;
+
+    if (prefetch_thread != NULL)
+    {
+        SDL_LockMutex(prefetch_mutex);
+
+        queue_length = 0;
+
+        for (i=0; i<numlumps; ++i)
+        {
+            if (lumpstate[i] == PREFETCH_QUEUED)
+            {
+                lumpstate[i] = PREFETCH_NONE;
+            }
+
+            while (lumpstate[i] == PREFETCH_READING)
+            {
+                SDL_CondWait(ready_cond, prefetch_mutex);
+            }
+
+            if (lumpstate[i] == PREFETCH_READY)
+            {
+                FreeLump(i);
+            }
+        }
+
+        SDL_UnlockMutex(prefetch_mutex);
+    }
+
+    C_Printf(" prefetch: %i lumps ready, %i waited for, %i not started, "
+             "%i ms stalled\n",
+             lumps_ready, lumps_waited, lumps_missed, stall_time);
+}
+
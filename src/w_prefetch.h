@@ -0,0 +1,63 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+// 02111-1307, USA.
+//
+// DESCRIPTION:
+//       Background lump loading ahead of level setup.
+//
+
+#ifndef W_PREFETCH_H
+#define W_PREFETCH_H
+
+#include "doomtype.h"
+
+void W_PrefetchInit(void);
+
+// Queue a lump to be read by the loader thread.
+
+void W_PrefetchLump(int lump);
+
+// True if the lump is queued or being read.
+
+boolean W_PrefetchPending(int lump);
+
+// Copy a lump read by the loader thread into dest, waiting if it is
+// being read.  Returns false if the lump has to be read from the file.
+
+boolean W_PrefetchClaim(unsigned int lump, void *dest);
+
+// Held around reads from WAD files shared with the loader thread.
+
+void W_PrefetchLock(void);
+void W_PrefetchUnlock(void);
+
+// Time the main thread spent reading from WAD files.
+
+void W_PrefetchStall(int ms);
+
+void W_PrefetchResetStats(void);
+
+// Drop anything still queued or unclaimed, and report the stall time
+// since W_PrefetchResetStats.
+
+void W_PrefetchFinish(void);
+
+#endif /* #ifndef W_PREFETCH_H */
+
@@ -28,8 +28,12 @@
 #include "doomtype.h"
 #include "i_swap.h"
 #include "i_system.h"
+#include "i_timer.h"
 #include "i_video.h"
+#include "m_argv.h"
 #include "m_misc.h"
+#include "w_index.h"
+#include "w_prefetch.h"
 #include "w_wad.h"
 #include "z_zone.h"
 
@@ -68,9 +72,34 @@ unsigned int      numlumps = 0;
 
 lumpinfo_t        *lumpinfo;                
 
-// Hash table for fast lookups
+// Hash table for fast lookups: open addressing, keyed by the upper
+// case lump name packed into 64 bits, so a probe is an integer
+// compare.  The table is at least twice the size of lumpinfo, and
+// holds each name once, for the last lump with it.
 
-static lumpinfo_t **lumphash;
+typedef struct
+{
+    uint64_t    key;
+    int         lump;           // -1 if the slot is empty
+} lumphash_t;
+
+static lumphash_t *lumphash;
+static unsigned int lumphashmask;
+static unsigned int lumphashshift;
+
+// Lump cache counters: lumps found in the cache, lumps read in,
+// and lumps read in again after they were purged.
+
+static int        cachehits;
+static int        cachemisses;
+static int        cacherereads;
+
+// With -dedup: lumps with the same contents as an earlier lump, their
+// total size, and cache lookups served from the earlier lump's cache.
+
+static int        aliasedlumps;
+static int        aliasedbytes;
+static int        aliashits;
 
 // Hash function used for lump names.
 
@@ -93,6 +122,41 @@ unsigned int W_LumpNameHash(const char *s)
     return result;
 }
 
+// Pack a lump name, upper cased, into 64 bits.
+
+uint64_t W_LumpNameKey(const char *s)
+{
+    uint64_t result = 0;
+    unsigned int i;
+    int c;
+
+    for (i=0; i < 8 && s[i] != '\0'; ++i)
+    {
+        c = s[i];
+
+        // Not toupper(), which is a call per character
+
+        if (c >= 'a' && c <= 'z')
+        {
+            c -= 'a' - 'A';
+        }
+
+        result = (result << 8) | (unsigned char) c;
+    }
+
+    // Pad on the right, as if with NULs
+
+    return i > 0 ? result << (64 - i * 8) : 0;
+}
+
+// Fibonacci hashing; the top bits of the product are the best mixed.
+
+static inline unsigned int KeyHash(uint64_t key)
+{
+    return (((unsigned int) (key >> 32) ^ (unsigned int) key) * 2654435761U)
+           >> lumphashshift;
+}
+
 // Increase the size of the lumpinfo[] array to the specified size.
 static void ExtendLumpInfo(int newnumlumps)
 {
@@ -117,14 +181,6 @@ static void ExtendLumpInfo(int newnumlumps)
         {
             Z_ChangeUser(newlumpinfo[i].cache, &newlumpinfo[i].cache);
         }
-
-        // We shouldn't be generating a hash table until after all WADs have
-        // been loaded, but just in case...
-        if (lumpinfo[i].next != NULL)
-        {
-            int nextlumpnum = lumpinfo[i].next - lumpinfo;
-            newlumpinfo[i].next = &newlumpinfo[nextlumpnum];
-        }
     }
 
     // All done.
@@ -133,6 +189,179 @@ static void ExtendLumpInfo(int newnumlumps)
     numlumps = newnumlumps;
 }
 
+// Save a WAD header and directory in the lump index, with the
+// header as it is on disk.
+
+static void IndexDirectory(sha1_digest_t key, wadinfo_t *header,
+                           filelump_t *fileinfo, int length)
+{
+    wadinfo_t *data;
+
+    data = Z_Malloc(sizeof(wadinfo_t) + length, PU_STATIC, 0);
+
+    memcpy(data->identification, header->identification, 4);
+    data->numlumps = LONG(header->numlumps);
+    data->infotableofs = LONG(header->infotableofs);
+    memcpy(data + 1, fileinfo, length);
+
+    W_IndexStore(INDEX_DIRECTORY, key, data, sizeof(wadinfo_t) + length);
+
+    Z_Free(data);
+}
+
+// Work out a fingerprint of the contents of each lump from startlump
+// on, which all come from the same file.  The fingerprints are kept in
+// the lump index, so each file is only read through once.
+
+static void FingerprintLumps(int startlump, boolean indexed,
+                             sha1_digest_t key)
+{
+    sha1_context_t context;
+    sha1_digest_t digest;
+    uint64_t *fingerprints;
+    void *cached;
+    byte *buffer = NULL;
+    int buffersize = 0;
+    int cachedlength;
+    int count;
+    int i;
+    lumpinfo_t *lump;
+
+    count = numlumps - startlump;
+
+    if (indexed
+     && W_IndexLookup(INDEX_FINGERPRINTS, key, &cached, &cachedlength)
+     && cachedlength == count * sizeof(uint64_t))
+    {
+        for (i=0; i<count; ++i)
+        {
+            memcpy(&lumpinfo[startlump + i].fingerprint,
+                   (byte *) cached + i * sizeof(uint64_t), sizeof(uint64_t));
+        }
+
+        return;
+    }
+
+    fingerprints = Z_Malloc(count * sizeof(uint64_t), PU_STATIC, 0);
+
+    for (i=0; i<count; ++i)
+    {
+        lump = &lumpinfo[startlump + i];
+
+        if (lump->size <= 0)
+        {
+            lump->fingerprint = 0;
+        }
+        else
+        {
+            if (lump->size > buffersize)
+            {
+                if (buffer != NULL)
+                {
+                    Z_Free(buffer);
+                }
+
+                buffersize = lump->size;
+                buffer = Z_Malloc(buffersize, PU_STATIC, 0);
+            }
+
+            if (W_Read(lump->wad_file, lump->position, buffer, lump->size)
+              < (size_t) lump->size)
+            {
+                I_Error("FingerprintLumps: couldn't read lump %i", i);
+            }
+
+            SHA1_Init(&context);
+            SHA1_Update(&context, buffer, lump->size);
+            SHA1_Final(digest, &context);
+
+            memcpy(&lump->fingerprint, digest, sizeof(uint64_t));
+
+            // 0 means no fingerprint
+
+            if (lump->fingerprint == 0)
+            {
+                lump->fingerprint = 1;
+            }
+        }
+
+        fingerprints[i] = lump->fingerprint;
+    }
+
+    if (indexed)
+    {
+        W_IndexStore(INDEX_FINGERPRINTS, key, fingerprints,
+                     count * sizeof(uint64_t));
+    }
+
+    if (buffer != NULL)
+    {
+        Z_Free(buffer);
+    }
+
+    Z_Free(fingerprints);
+}
+
+// Point each lump at the first lump with the same size and fingerprint,
+// if there is one, so that they share a single cache entry.
+
+static void ResolveAliases(void)
+{
+    unsigned int i, size, slot;
+    int *table;
+    int j;
+    lumpinfo_t *lump;
+
+    for (size = 1; size < numlumps * 2; size <<= 1);
+
+    table = Z_Malloc(sizeof(int) * size, PU_STATIC, 0);
+
+    for (i=0; i<size; ++i)
+    {
+        table[i] = -1;
+    }
+
+    aliasedlumps = 0;
+    aliasedbytes = 0;
+
+    for (i=0; i<numlumps; ++i)
+    {
+        lump = &lumpinfo[i];
+        lump->alias = -1;
+
+        if (lump->fingerprint == 0)
+        {
+            continue;
+        }
+
+        // The fingerprint is already well mixed, so its low bits will do
+
+        for (slot = (unsigned int) lump->fingerprint & (size - 1);
+             (j = table[slot]) >= 0;
+             slot = (slot + 1) & (size - 1))
+        {
+            if (lumpinfo[j].fingerprint == lump->fingerprint
+             && lumpinfo[j].size == lump->size)
+            {
+                lump->alias = j;
+                break;
+            }
+        }
+
+        if (lump->alias >= 0)
+        {
+            ++aliasedlumps;
+            aliasedbytes += lump->size;
+        }
+        else
+        {
+            table[slot] = i;
+        }
+    }
+
+    Z_Free(table);
+}
+
 //
 // LUMP BASED ROUTINES.
 //
@@ -157,6 +386,10 @@ wad_file_t *W_AddFile (char *filename, boolean automatic)
     filelump_t *fileinfo;
     filelump_t *filerover;
     int newnumlumps;
+    sha1_digest_t key;
+    boolean indexed = false;
+    void *cached;
+    int cachedlength;
 
     // open the file and add to directory
 
@@ -171,7 +404,11 @@ wad_file_t *W_AddFile (char *filename, boolean automatic)
 
     newnumlumps = numlumps;
 
-    if (strcasecmp(filename+strlen(filename)-3 , "wad" ) )
+    // ZIP and PK3 archives are opened as a virtual PWAD (w_file_zip.c).
+
+    if (strcasecmp(filename+strlen(filename)-3 , "wad" )
+     && strcasecmp(filename+strlen(filename)-3 , "zip" )
+     && strcasecmp(filename+strlen(filename)-3 , "pk3" ) )
     {
         // single lump file
 
@@ -193,7 +430,33 @@ wad_file_t *W_AddFile (char *filename, boolean automatic)
     else 
     {
         // WAD file
-        W_Read(wad_file, 0, &header, sizeof(header));
+
+        // Take the header and directory from the lump index if this
+        // file hasn't changed since they were saved.
+
+        indexed = W_IndexFileKey(filename, key);
+
+        if (!indexed
+         || !W_IndexLookup(INDEX_DIRECTORY, key, &cached, &cachedlength)
+         || cachedlength < sizeof(header))
+        {
+            cached = NULL;
+        }
+        else
+        {
+            memcpy(&header, cached, sizeof(header));
+
+            if (cachedlength != sizeof(header)
+                              + LONG(header.numlumps) * sizeof(filelump_t))
+            {
+                cached = NULL;
+            }
+        }
+
+        if (cached == NULL)
+        {
+            W_Read(wad_file, 0, &header, sizeof(header));
+        }
 
         if (strncmp(header.identification,"IWAD",4))
         {
@@ -210,9 +473,23 @@ wad_file_t *W_AddFile (char *filename, boolean automatic)
         header.numlumps = LONG(header.numlumps);
         header.infotableofs = LONG(header.infotableofs);
         length = header.numlumps*sizeof(filelump_t);
+
         fileinfo = Z_Malloc(length, PU_STATIC, 0);
 
-        W_Read(wad_file, header.infotableofs, fileinfo, length);
+        if (cached != NULL)
+        {
+            memcpy(fileinfo, (byte *) cached + sizeof(header), length);
+        }
+        else
+        {
+            W_Read(wad_file, header.infotableofs, fileinfo, length);
+
+            if (indexed)
+            {
+                IndexDirectory(key, &header, fileinfo, length);
+            }
+        }
+
         newnumlumps += header.numlumps;
     }
 
@@ -230,6 +507,8 @@ wad_file_t *W_AddFile (char *filename, boolean automatic)
         lump_p->position = LONG(filerover->filepos);
         lump_p->size = LONG(filerover->size);
         lump_p->cache = NULL;
+        lump_p->fingerprint = 0;
+        lump_p->alias = -1;
         strncpy(lump_p->name, filerover->name, 8);
 
         ++lump_p;
@@ -271,6 +550,21 @@ wad_file_t *W_AddFile (char *filename, boolean automatic)
                 header.identification, uppercase(filename));
     }
 
+    //!
+    // Share one cache entry between lumps with identical contents,
+    // such as patches repeated by stacked PWADs.  Each WAD is read
+    // through once to fingerprint its lumps.
+    //
+
+    if (M_CheckParm("-dedup"))
+    {
+        FingerprintLumps(startlump, indexed, key);
+        ResolveAliases();
+
+        C_Printf(" %i lumps (%i bytes) identical to earlier lumps\n",
+                 aliasedlumps, aliasedbytes);
+    }
+
     return wad_file;
 }
 
@@ -283,24 +577,32 @@ wad_file_t *W_AddFile (char *filename, boolean automatic)
 
 int W_CheckNumForName (char* name)
 {
-    lumpinfo_t *lump_p;
     int i;
 
     // Do we have a hash table yet?
 
     if (lumphash != NULL)
     {
-        int hash;
+        lumphash_t *entry;
+        uint64_t key;
+        unsigned int hash;
         
         // We do! Excellent.
 
-        hash = W_LumpNameHash(name) % numlumps;
-        
-        for (lump_p = lumphash[hash]; lump_p != NULL; lump_p = lump_p->next)
+        key = W_LumpNameKey(name);
+
+        for (hash = KeyHash(key); ; hash = (hash + 1) & lumphashmask)
         {
-            if (!strncasecmp(lump_p->name, name, 8))
+            entry = &lumphash[hash];
+
+            if (entry->lump < 0)
+            {
+                break;
+            }
+
+            if (entry->key == key)
             {
-                return lump_p - lumpinfo;
+                return entry->lump;
             }
         }
     } 
@@ -386,6 +688,7 @@ int W_LumpLength (unsigned int lump)
 void W_ReadLump(unsigned int lump, void *dest)
 {
     int c;
+    int starttime;
     lumpinfo_t *l;
         
     if (lump >= numlumps)
@@ -394,10 +697,23 @@ void W_ReadLump(unsigned int lump, void *dest)
     }
 
     l = lumpinfo+lump;
-        
+
+    // Already read by the prefetch thread?
+
+    if (W_PrefetchClaim(lump, dest))
+    {
+        return;
+    }
+
     I_BeginRead ();
-        
+
+    starttime = I_GetTimeMS();
+
+    W_PrefetchLock();
     c = W_Read(l->wad_file, l->position, dest, l->size);
+    W_PrefetchUnlock();
+
+    W_PrefetchStall(I_GetTimeMS() - starttime);
 
     if (c < l->size)
     {
@@ -433,6 +749,16 @@ void *W_CacheLumpNum(int lumpnum, int tag)
         I_Error ("W_CacheLumpNum: %i >= numlumps", lumpnum);
     }
 
+    // Lumps with the same contents share the first one's cache entry
+
+    if (lumpinfo[lumpnum].alias >= 0)
+    {
+        lumpnum = lumpinfo[lumpnum].alias;
+
+        if (lumpinfo[lumpnum].cache != NULL)
+            aliashits++;
+    }
+
     lump = &lumpinfo[lumpnum];
 
     // Get the pointer to return.  If the lump is in a memory-mapped
@@ -452,6 +778,9 @@ void *W_CacheLumpNum(int lumpnum, int tag)
 
         result = lump->cache;
         Z_ChangeTag(lump->cache, tag);
+        Z_Touch(lump->cache);
+
+        cachehits++;
     }
     else
     {
@@ -460,6 +789,13 @@ void *W_CacheLumpNum(int lumpnum, int tag)
         lump->cache = Z_Malloc(W_LumpLength(lumpnum), tag, &lump->cache);
         W_ReadLump (lumpnum, lump->cache);
         result = lump->cache;
+
+        cachemisses++;
+
+        if (lump->loaded)
+            cacherereads++;
+
+        lump->loaded = true;
     }
         
     return result;
@@ -494,6 +830,11 @@ void W_ReleaseLumpNum(int lumpnum)
         I_Error ("W_ReleaseLumpNum: %i >= numlumps", lumpnum);
     }
 
+    if (lumpinfo[lumpnum].alias >= 0)
+    {
+        lumpnum = lumpinfo[lumpnum].alias;
+    }
+
     lump = &lumpinfo[lumpnum];
 
     if (lump->wad_file->mapped != NULL)
@@ -511,6 +852,35 @@ void W_ReleaseLumpName(char *name)
     W_ReleaseLumpNum(W_GetNumForName(name));
 }
 
+//
+// W_WriteCacheStats
+// Writes the lump cache counters to f, or to the console.
+//
+void W_WriteCacheStats(FILE *f)
+{
+    int total = cachehits + cachemisses;
+
+    C_FPrintf(f, "lump cache: %i hits  %i misses  %i re-reads  "
+              "(%.1f%% hits)\n",
+              cachehits, cachemisses, cacherereads,
+              total ? 100.0 * cachehits / total : 0.0);
+
+    if (aliasedlumps > 0)
+    {
+        C_FPrintf(f, "lump aliases: %i lumps  %i bytes  "
+                  "%i shared hits\n",
+                  aliasedlumps, aliasedbytes, aliashits);
+    }
+}
+
+//
+// W_PrintCacheStats
+//
+void W_PrintCacheStats(void)
+{
+    W_WriteCacheStats(NULL);
+}
+
 #if 0
 
 //
@@ -577,41 +947,241 @@ void W_Profile (void)
 
 #endif
 
+// Find the aliases again once the directory is complete.  Lump
+// numbers may have changed since W_AddFile, with -merge.
+
+void W_ResolveAliases(void)
+{
+    if (M_CheckParm("-dedup"))
+    {
+        ResolveAliases();
+    }
+}
+
 // Generate a hash table for fast lookups
 
 void W_GenerateHashTable(void)
 {
     unsigned int i;
+    unsigned int size;
 
     // Free the old hash table, if there is one
 
     if (lumphash != NULL)
     {
         Z_Free(lumphash);
+        lumphash = NULL;
     }
 
     // Generate hash table
     if (numlumps > 0)
     {
-        lumphash = Z_Malloc(sizeof(lumpinfo_t *) * numlumps, PU_STATIC, NULL);
-        memset(lumphash, 0, sizeof(lumpinfo_t *) * numlumps);
+        lumphashshift = 32;
+
+        for (size = 1; size < numlumps * 2; size <<= 1)
+        {
+            --lumphashshift;
+        }
+
+        lumphash = Z_Malloc(sizeof(lumphash_t) * size, PU_STATIC, NULL);
+        lumphashmask = size - 1;
+
+        for (i=0; i<size; ++i)
+        {
+            lumphash[i].lump = -1;
+        }
 
         for (i=0; i<numlumps; ++i)
         {
+            uint64_t key;
             unsigned int hash;
 
-            hash = W_LumpNameHash(lumpinfo[i].name) % numlumps;
+            key = W_LumpNameKey(lumpinfo[i].name);
+
+            // Find the slot for this name; a later lump with the same
+            // name takes the slot over, so patch lumps take precedence
 
-            // Hook into the hash table
+            for (hash = KeyHash(key);
+                 lumphash[hash].lump >= 0 && lumphash[hash].key != key;
+                 hash = (hash + 1) & lumphashmask);
 
-            lumpinfo[i].next = lumphash[hash];
-            lumphash[hash] = &lumpinfo[i];
+            lumphash[hash].key = key;
+            lumphash[hash].lump = i;
         }
     }
 
     // All done!
 }
 
+//
+// W_BenchmarkHashTable
+// Times W_CheckNumForName against the chained hash table it replaced
+// (djb2 of the name, strncasecmp down the chain), on a made up
+// directory of count lumps.  Half the lookups are hits, in lower
+// case, and half are misses.
+//
+
+void W_BenchmarkHashTable(int count)
+{
+    lumpinfo_t *savedlumpinfo;
+    unsigned int savednumlumps;
+    lumphash_t *savedhash;
+    unsigned int savedmask;
+    unsigned int savedshift;
+    char (*queries)[9];
+    int *heads;
+    int *chain;
+    int numqueries;
+    int oldresult, newresult;
+    unsigned int start, oldtime, newtime;
+    int i, j, round;
+
+    savedlumpinfo = lumpinfo;
+    savednumlumps = numlumps;
+    savedhash = lumphash;
+    savedmask = lumphashmask;
+    savedshift = lumphashshift;
+
+    // Every tenth lump replaces an earlier one, like a PWAD would
+
+    lumpinfo = calloc(count, sizeof(lumpinfo_t));
+    numlumps = count;
+    lumphash = NULL;
+
+    for (i=0; i<count; ++i)
+    {
+        char name[9];
+
+        j = (i % 10 == 9) ? i / 2 : i;
+        M_snprintf(name, sizeof(name), "L%c%06d", 'A' + j % 26, j);
+        strncpy(lumpinfo[i].name, name, 8);
+    }
+
+    numqueries = count * 2;
+    queries = malloc(numqueries * sizeof(*queries));
+
+    for (i=0; i<count; ++i)
+    {
+        j = (i * 7919) % count;
+        memcpy(queries[i * 2], lumpinfo[j].name, 8);
+        queries[i * 2][8] = '\0';
+        queries[i * 2][0] = 'l';
+        M_snprintf(queries[i * 2 + 1], 9, "M%07d", i);
+    }
+
+    // The old table
+
+    heads = malloc(count * sizeof(int));
+    chain = malloc(count * sizeof(int));
+
+    for (i=0; i<count; ++i)
+    {
+        heads[i] = -1;
+    }
+
+    for (i=0; i<count; ++i)
+    {
+        unsigned int hash = W_LumpNameHash(lumpinfo[i].name) % count;
+
+        chain[i] = heads[hash];
+        heads[hash] = i;
+    }
+
+    // The new one
+
+    W_GenerateHashTable();
+
+    // Check they agree, then time them
+
+    for (i=0; i<numqueries; ++i)
+    {
+        oldresult = -1;
+
+        for (j = heads[W_LumpNameHash(queries[i]) % count]; j >= 0; j = chain[j])
+        {
+            if (!strncasecmp(lumpinfo[j].name, queries[i], 8))
+            {
+                oldresult = j;
+                break;
+            }
+        }
+
+        if (oldresult != W_CheckNumForName(queries[i]))
+        {
+            I_Error("W_BenchmarkHashTable: lookups disagree on %s", queries[i]);
+        }
+    }
+
+    oldresult = 0;
+    start = I_GetTimeUS();
+
+    for (round=0; round<10; ++round)
+    {
+        for (i=0; i<numqueries; ++i)
+        {
+            for (j = heads[W_LumpNameHash(queries[i]) % count]; j >= 0; j = chain[j])
+            {
+                if (!strncasecmp(lumpinfo[j].name, queries[i], 8))
+                {
+                    oldresult += j;
+                    break;
+                }
+            }
+        }
+    }
+
+    oldtime = I_GetTimeUS() - start;
+
+    newresult = 0;
+    start = I_GetTimeUS();
+
+    for (round=0; round<10; ++round)
+    {
+        for (i=0; i<numqueries; ++i)
+        {
+            j = W_CheckNumForName(queries[i]);
+
+            if (j >= 0)
+            {
+                newresult += j;
+            }
+        }
+    }
+
+    newtime = I_GetTimeUS() - start;
+
+    if (oldresult != newresult)
+    {
+        I_Error("W_BenchmarkHashTable: lookups disagree");
+    }
+
+    printf(" W_BenchmarkHashTable: %i lumps, %i lookups\n", count, numqueries * 10);
+    printf("   chained:         %u us, %.1f ns per lookup\n",
+           oldtime, oldtime * 1000.0 / (numqueries * 10));
+    printf("   open addressing: %u us, %.1f ns per lookup\n",
+           newtime, newtime * 1000.0 / (numqueries * 10));
+
+    C_Printf(" W_BenchmarkHashTable: %i lumps, %i lookups\n", count, numqueries * 10);
+    C_Printf("   chained:         %u us, %.1f ns per lookup\n",
+             oldtime, oldtime * 1000.0 / (numqueries * 10));
+    C_Printf("   open addressing: %u us, %.1f ns per lookup\n",
+             newtime, newtime * 1000.0 / (numqueries * 10));
+
+    // Put the real directory back
+
+    Z_Free(lumphash);
+    free(lumpinfo);
+    free(queries);
+    free(heads);
+    free(chain);
+
+    lumpinfo = savedlumpinfo;
+    numlumps = savednumlumps;
+    lumphash = savedhash;
+    lumphashmask = savedmask;
+    lumphashshift = savedshift;
+}
+
 void W_CheckSize(int wad)
 {
     FILE *fprw = NULL;
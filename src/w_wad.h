@@ -46,9 +46,16 @@ struct lumpinfo_s
     int         size;
     void        *cache;
 
-    // Used for hash table lookups
+    // Set once the lump has been read into the cache
 
-    lumpinfo_t  *next;
+    boolean     loaded;
+
+    // With -dedup, the start of a SHA-1 of the lump's contents (0 if
+    // not known), and the earlier lump with the same contents whose
+    // cache this lump shares (-1 if none).
+
+    uint64_t    fingerprint;
+    int         alias;
 };
 
 
@@ -56,6 +63,7 @@ extern lumpinfo_t   *lumpinfo;
 
 extern unsigned int numlumps;
 extern unsigned int W_LumpNameHash(const char *s);
+extern uint64_t W_LumpNameKey(const char *s);
 
 wad_file_t *W_AddFile (char *filename, boolean automatic);
 
@@ -64,9 +72,13 @@ int        W_GetNumForName (char* name);
 int        W_GetSecondNumForName (char* name);
 int        W_LumpLength (unsigned int lump);
 
+void       W_ResolveAliases(void);
 void       W_GenerateHashTable(void);
+void       W_BenchmarkHashTable(int count);
 void       W_ReleaseLumpNum(int lump);
 void       W_ReleaseLumpName(char *name);
+void       W_PrintCacheStats(void);
+void       W_WriteCacheStats(FILE *f);
 void       W_CheckCorrectIWAD(GameMission_t mission);
 void       W_CheckSize(int wad);
 void       W_ReadLump (unsigned int lump, void *dest);
@@ -35,6 +35,7 @@
 #include "i_system.h"
 #include "m_misc.h"
 #include "m_random.h"
+#include "p_setup.h"
 #include "r_local.h"
 #include "s_sound.h"
 
@@ -1558,6 +1559,13 @@ void WI_Ticker(void)
         {
             S_ChangeMusic(mus_inter, true); 
         }
+
+        // start loading the next level
+        P_PrefetchLevel(wbs->epsd + 1, wbs->next + 1);
+    }
+    else
+    {
+        P_PrefetchTicker();
     }
 
     WI_checkForAccelerate();
@@ -17,7 +17,11 @@
 //
 
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "c_io.h"
+#include "d_loop.h"
 #include "doomtype.h"
 #include "i_system.h"
 #include "z_zone.h"
@@ -28,16 +32,31 @@
 //
 // There is never any space between memblocks,
 //  and there will never be two contiguous free memblocks.
-// The rover can be left pointing at a non-empty block.
 //
 // It is of no value to free a cachable block,
 //  because it will get overwritten automatically if needed.
+//
+// Free blocks are also kept on segregated free lists, indexed
+//  by a two level size class (power of two, then SL_INDEX_COUNT
+//  linear subdivisions of it), with bitmaps of the non-empty
+//  lists.  This gives an O(1) good fit allocation and O(1) free;
+//  the block list only has to be walked when no free block is
+//  big enough and purgable blocks must be thrown out.
+//
+// The purgable blocks are also kept on a list, least recently
+//  used first (see Z_Touch), so the blocks thrown out are the run
+//  around the oldest purgable block that makes enough room,
+//  found without walking the whole block list.
 // 
  
 #define MEM_ALIGN     sizeof(void *)
 #define ZONEID        0x1d4a11
 #define MINFRAGMENT   64
 
+#define SL_INDEX_BITS   4
+#define SL_INDEX_COUNT  (1 << SL_INDEX_BITS)
+#define FL_INDEX_COUNT  31
+
 
 typedef struct memblock_s
 {
@@ -47,9 +66,24 @@ typedef struct memblock_s
     int                   id;   // should be ZONEID
     struct memblock_s*    next;
     struct memblock_s*    prev;
+    int                   site; // Z_Malloc call that made it
+    struct memblock_s*    lrunext; // purgable blocks only
+    struct memblock_s*    lruprev;
 } memblock_t;
 
 
+// The free list links of a free block are stored in its body,
+// so every block is at least this big.
+
+typedef struct
+{
+    memblock_t*           next;
+    memblock_t*           prev;
+} freelinks_t;
+
+#define FREELINKS(block) ((freelinks_t *) ((byte *) (block) + sizeof(memblock_t)))
+
+
 typedef struct
 {
     // total bytes malloced, including header
@@ -57,8 +91,14 @@ typedef struct
 
     // start / end cap for linked list
     memblock_t         blocklist;
-    
-    memblock_t*        rover;
+
+    // start / end cap for the purgable blocks, oldest first
+    memblock_t         lrulist;
+
+    // segregated free lists, and bitmaps of which are non-empty
+    unsigned int       fl_bitmap;
+    unsigned int       sl_bitmap[FL_INDEX_COUNT];
+    memblock_t*        freelists[FL_INDEX_COUNT][SL_INDEX_COUNT];
     
 } memzone_t;
 
@@ -66,6 +106,374 @@ typedef struct
 memzone_t*        mainzone;
 
 
+//
+// LEVEL ARENA
+//
+// Map data that lives exactly as long as the level is bump
+//  allocated from a few large zone blocks, without a block header
+//  each, and is all thrown away at once by Z_LevelReset.
+//
+
+#define ARENA_CHUNKSIZE (256 * 1024)
+
+typedef struct arenachunk_s
+{
+    struct arenachunk_s*  next;
+    int                   size; // usable bytes after the chunk header
+    int                   used;
+} arenachunk_t;
+
+static arenachunk_t*      levelarena;
+static int                arenaused;
+
+
+//
+// OBJECT POOLS
+//
+// Fixed size objects that are spawned and removed all the time
+//  (mobjs and sector thinkers) come from typed pools: slabs of
+//  contiguous slots carved out of the level arena, and a free list
+//  of the slots not in use.  Every slot starts with a pointer to
+//  its pool, so it can be freed without knowing its type.
+//  All the pools are emptied along with the level arena.
+//
+
+#define POOLID          0x1d4a12
+#define POOL_SLABSLOTS  64
+
+typedef struct
+{
+    mempool_t*            pool;
+    int                   id;   // POOLID while in use
+} poolslot_t;
+
+static mempool_t*         pools;        // pools with any slots
+
+
+//
+// TELEMETRY
+//
+// Every block remembers the Z_Malloc call that made it, so the
+//  live and peak bytes and the number of allocations can be kept
+//  per tag and per call site.  Sites past MAXSITES share the
+//  first slot.
+//
+
+#define MAXSITES        256
+#define SITEHASHSIZE    512
+
+typedef struct
+{
+    int                   live; // bytes, including the block headers
+    int                   peak;
+    int                   allocs;
+    int                   frees;
+} zonestats_t;
+
+typedef struct
+{
+    char*                 file;
+    int                   line;
+    zonestats_t           stats;
+} zonesite_t;
+
+static zonestats_t        tagstats[PU_NUM_TAGS];
+static zonesite_t         sites[MAXSITES] = { { "(other)", 0 } };
+static short              sitehash[SITEHASHSIZE]; // site + 1, 0 if empty
+static int                numsites = 1;
+
+static int                freebytes;    // in all the free blocks
+static int                totalallocs;
+static int                firsttic = -1;
+static int                stattic;
+static int                ticallocs;    // allocations during stattic
+static int                peakticallocs;
+static int                purgedblocks;
+static int                purgedbytes;
+static void               (*purgecallback) (void);
+
+static char*              tagnames[PU_NUM_TAGS] =
+{
+    "-", "static", "sound", "music", "free",
+    "level", "levspec", "purgelevel", "cache"
+};
+
+
+//
+// Z_SizeClass
+// Maps a block size to the free list it is kept on.
+//
+static void Z_SizeClass (int size, int* fl, int* sl)
+{
+    int         f;
+
+    f = 31 - __builtin_clz(size);
+
+    *fl = f;
+    *sl = (size >> (f - SL_INDEX_BITS)) - SL_INDEX_COUNT;
+}
+
+
+//
+// Z_InsertFree
+// Puts a free block at the head of the list for its size.
+//
+static void Z_InsertFree (memzone_t* zone, memblock_t* block)
+{
+    int         fl, sl;
+    memblock_t* head;
+
+    Z_SizeClass (block->size, &fl, &sl);
+
+    head = zone->freelists[fl][sl];
+
+    FREELINKS(block)->next = head;
+    FREELINKS(block)->prev = NULL;
+
+    if (head)
+        FREELINKS(head)->prev = block;
+
+    zone->freelists[fl][sl] = block;
+    zone->fl_bitmap |= 1U << fl;
+    zone->sl_bitmap[fl] |= 1U << sl;
+
+    freebytes += block->size;
+}
+
+
+//
+// Z_RemoveFree
+// Takes a free block off its free list.
+//
+static void Z_RemoveFree (memzone_t* zone, memblock_t* block)
+{
+    int         fl, sl;
+    freelinks_t* links;
+
+    Z_SizeClass (block->size, &fl, &sl);
+
+    links = FREELINKS(block);
+
+    if (links->next)
+        FREELINKS(links->next)->prev = links->prev;
+
+    if (links->prev)
+        FREELINKS(links->prev)->next = links->next;
+    else
+        zone->freelists[fl][sl] = links->next;
+
+    if (zone->freelists[fl][sl] == NULL)
+    {
+        zone->sl_bitmap[fl] &= ~(1U << sl);
+
+        if (!zone->sl_bitmap[fl])
+            zone->fl_bitmap &= ~(1U << fl);
+    }
+
+    freebytes -= block->size;
+}
+
+
+//
+// Z_FindFree
+// Returns a free block of at least size bytes, or NULL.
+// Any block on a list of a bigger size class fits, so those are
+// tried first; the list for size itself is walked only when
+// nothing bigger is free.
+//
+static memblock_t* Z_FindFree (memzone_t* zone, int size)
+{
+    int          fl, sl;
+    unsigned int map;
+    memblock_t*  block;
+
+    Z_SizeClass (size, &fl, &sl);
+
+    if (sl + 1 < SL_INDEX_COUNT)
+        map = zone->sl_bitmap[fl] & (~0U << (sl + 1));
+    else
+        map = 0;
+
+    if (!map)
+    {
+        map = zone->fl_bitmap & (~0U << (fl + 1));
+
+        if (!map)
+        {
+            for (block = zone->freelists[fl][sl] ;
+                 block ;
+                 block = FREELINKS(block)->next)
+            {
+                if (block->size >= size)
+                    return block;
+            }
+
+            return NULL;
+        }
+
+        fl = __builtin_ctz(map);
+        map = zone->sl_bitmap[fl];
+    }
+
+    sl = __builtin_ctz(map);
+
+    return zone->freelists[fl][sl];
+}
+
+
+//
+// Z_SiteNumber
+// Returns the telemetry slot for a Z_Malloc call site.
+//
+static int Z_SiteNumber (char* file, int line)
+{
+    unsigned int       h;
+    int                site;
+
+    h = ((unsigned int) (size_t) file >> 2) * 31 + line;
+
+    for (h &= SITEHASHSIZE - 1 ; sitehash[h] ; h = (h + 1) & (SITEHASHSIZE - 1))
+    {
+        site = sitehash[h] - 1;
+
+        if (sites[site].line == line
+         && (sites[site].file == file || !strcmp (sites[site].file, file)))
+            return site;
+    }
+
+    if (numsites == MAXSITES)
+        return 0;
+
+    site = numsites++;
+
+    sites[site].file = file;
+    sites[site].line = line;
+    sitehash[h] = site + 1;
+
+    return site;
+}
+
+
+//
+// Z_AddStats
+//
+static void Z_AddStats (zonestats_t* stats, int size)
+{
+    stats->live += size;
+    stats->allocs++;
+
+    if (stats->live > stats->peak)
+        stats->peak = stats->live;
+}
+
+
+//
+// Z_LinkLRU
+// Puts a purgable block at the most recently used end of the list.
+//
+static void Z_LinkLRU (memzone_t* zone, memblock_t* block)
+{
+    block->lrunext = &zone->lrulist;
+    block->lruprev = zone->lrulist.lruprev;
+    block->lruprev->lrunext = block;
+    zone->lrulist.lruprev = block;
+}
+
+
+//
+// Z_UnlinkLRU
+//
+static void Z_UnlinkLRU (memblock_t* block)
+{
+    block->lruprev->lrunext = block->lrunext;
+    block->lrunext->lruprev = block->lruprev;
+}
+
+
+//
+// Z_PurgeLRU
+// Throws out purgable blocks to make a free block of at least
+// size bytes, and returns it, or NULL if there is no room even
+// with every purgable block gone.
+// The purgable blocks are tried oldest first, and the first one
+// that starts a run of free and purgable blocks big enough (taking
+// in the free block before it) is thrown out with the rest of the
+// run, so that blocks in use this tic go last.
+//
+static memblock_t* Z_PurgeLRU (int size)
+{
+    memblock_t*        oldest;
+    memblock_t*        start;
+    memblock_t*        block;
+    memblock_t*        anchor;
+    int                total;
+
+    start = NULL;
+
+    for (oldest = mainzone->lrulist.lrunext ;
+         oldest != &mainzone->lrulist ;
+         oldest = oldest->lrunext)
+    {
+        start = oldest->prev->tag == PU_FREE ? oldest->prev : oldest;
+        total = 0;
+
+        for (block = start ;
+             block != &mainzone->blocklist
+              && (block->tag == PU_FREE || block->tag >= PU_PURGELEVEL) ;
+             block = block->next)
+        {
+            total += block->size;
+
+            if (total >= size)
+                break;
+        }
+
+        if (total >= size)
+            break;
+    }
+
+    if (oldest == &mainzone->lrulist)
+        return NULL;
+
+    // let anything still holding pointers into purgable blocks
+    // finish with them first
+    if (purgecallback)
+        purgecallback ();
+
+    // free the run from the front; the block before it stays
+    // put, whether or not the freed blocks merge into it
+    anchor = start->prev;
+
+    for (;;)
+    {
+        block = anchor->tag == PU_FREE ? anchor : anchor->next;
+
+        if (block->tag == PU_FREE)
+        {
+            if (block->size >= size)
+                return block;
+
+            block = block->next;
+        }
+
+        purgedblocks++;
+        purgedbytes += block->size;
+
+        Z_Free ((byte *) block + sizeof(memblock_t));
+    }
+}
+
+
+//
+// Z_SetPurgeCallback
+// Called before any purgable block is thrown out.
+//
+void Z_SetPurgeCallback (void (*callback) (void))
+{
+    purgecallback = callback;
+}
+
+
 //
 // Z_ClearZone
 //
@@ -80,7 +488,8 @@ void Z_ClearZone (memzone_t* zone)
     
     zone->blocklist.user = (void *)zone;
     zone->blocklist.tag = PU_STATIC;
-    zone->rover = block;
+
+    zone->lrulist.lrunext = zone->lrulist.lruprev = &zone->lrulist;
         
     block->prev = block->next = &zone->blocklist;
     
@@ -88,6 +497,13 @@ void Z_ClearZone (memzone_t* zone)
     block->tag = PU_FREE;
 
     block->size = zone->size - sizeof(memzone_t);
+
+    memset (zone->sl_bitmap, 0, sizeof(zone->sl_bitmap));
+    memset (zone->freelists, 0, sizeof(zone->freelists));
+    zone->fl_bitmap = 0;
+    freebytes = 0;
+
+    Z_InsertFree (zone, block);
 }
 
 
@@ -110,7 +526,8 @@ void Z_Init (void)
 
     mainzone->blocklist.user = (void *)mainzone;
     mainzone->blocklist.tag = PU_STATIC;
-    mainzone->rover = block;
+
+    mainzone->lrulist.lrunext = mainzone->lrulist.lruprev = &mainzone->lrulist;
         
     block->prev = block->next = &mainzone->blocklist;
 
@@ -118,6 +535,13 @@ void Z_Init (void)
     block->tag = PU_FREE;
     
     block->size = mainzone->size - sizeof(memzone_t);
+
+    memset (mainzone->sl_bitmap, 0, sizeof(mainzone->sl_bitmap));
+    memset (mainzone->freelists, 0, sizeof(mainzone->freelists));
+    mainzone->fl_bitmap = 0;
+    freebytes = 0;
+
+    Z_InsertFree (mainzone, block);
 }
 
 
@@ -140,6 +564,17 @@ void Z_Free (void* ptr)
             *block->user = 0;
     }
 
+    if (block->tag >= PU_PURGELEVEL)
+        Z_UnlinkLRU (block);
+
+    if (block->tag != PU_FREE)
+    {
+        tagstats[block->tag].live -= block->size;
+        tagstats[block->tag].frees++;
+        sites[block->site].stats.live -= block->size;
+        sites[block->site].stats.frees++;
+    }
+
     // mark as free
     block->tag = PU_FREE;
     block->user = NULL;
@@ -150,13 +585,12 @@ void Z_Free (void* ptr)
     if (other->tag == PU_FREE)
     {
         // merge with previous free block
+        Z_RemoveFree (mainzone, other);
+
         other->size += block->size;
         other->next = block->next;
         other->next->prev = other;
 
-        if (block == mainzone->rover)
-            mainzone->rover = other;
-
         block = other;
     }
         
@@ -164,13 +598,14 @@ void Z_Free (void* ptr)
     if (other->tag == PU_FREE)
     {
         // merge the next free block onto the end
+        Z_RemoveFree (mainzone, other);
+
         block->size += other->size;
         block->next = other->next;
         block->next->prev = block;
-
-        if (other == mainzone->rover)
-            mainzone->rover = block;
     }
+
+    Z_InsertFree (mainzone, block);
 }
 
 
@@ -181,77 +616,49 @@ void Z_Free (void* ptr)
 //
 
 void*
-Z_Malloc
+Z_Malloc2
 ( int                size,
   int                tag,
-  void*                user )
+  void*                user,
+  char*                file,
+  int                line )
 {
     int                extra;
-    memblock_t*        start;
-    memblock_t* rover;
     memblock_t* newblock;
     memblock_t*        base;
     void *result;
 
     size = (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
-    
-    // scan through the block list,
-    // looking for the first free block
-    // of sufficient size,
-    // throwing out any purgable blocks along the way.
 
+    // room for the free list links once the block is freed
+    if (size < sizeof(freelinks_t))
+        size = sizeof(freelinks_t);
+    
     // account for size of block header
     size += sizeof(memblock_t);
-    
-    // if there is a free block behind the rover,
-    //  back up over them
-    base = mainzone->rover;
-    
-    if (base->prev->tag == PU_FREE)
-        base = base->prev;
-        
-    rover = base;
-    start = base->prev;
-        
-    do
-    {
-        if (rover == start)
-        {
-            // scanned all the way around the list
-            I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
-        }
-        
-        if (rover->tag != PU_FREE)
-        {
-            if (rover->tag < PU_PURGELEVEL)
-            {
-                // hit a block that can't be purged,
-                // so move base past it
-                base = rover = rover->next;
-            }
-            else
-            {
-                // free the rover block (adding the size to base)
 
-                // the rover can be the base block
-                base = base->prev;
-                Z_Free ((byte *)rover+sizeof(memblock_t));
-                base = base->next;
-                rover = base->next;
-            }
-        }
-        else
-        {
-            rover = rover->next;
-        }
+    // take a free block of sufficient size from the free lists
+    base = Z_FindFree (mainzone, size);
 
-    } while (base->tag != PU_FREE || base->size < size);
+    if (base == NULL)
+    {
+        // nothing free is big enough:
+        // throw out the least recently used purgable blocks
+        base = Z_PurgeLRU (size);
 
+        if (base == NULL)
+            I_Error ("%s:%i: Z_Malloc: failed on allocation of %i bytes",
+                     file, line, size);
+    }
     
     // found a block big enough
+    Z_RemoveFree (mainzone, base);
+
     extra = base->size - size;
     
-    if (extra >  MINFRAGMENT)
+    // the fragment needs room for a header and the free list links
+    if (extra >  MINFRAGMENT
+     && extra >= sizeof(memblock_t) + sizeof(freelinks_t))
     {
         // there will be a free fragment after the allocated block
         newblock = (memblock_t *) ((byte *)base + size );
@@ -265,10 +672,13 @@ Z_Malloc
 
         base->next = newblock;
         base->size = size;
+
+        Z_InsertFree (mainzone, newblock);
     }
         
         if (user == NULL && tag >= PU_PURGELEVEL)
-            I_Error ("Z_Malloc: an owner is required for purgable blocks");
+            I_Error ("%s:%i: Z_Malloc: an owner is required "
+                     "for purgable blocks", file, line);
 
     base->user = user;
     base->tag = tag;
@@ -280,16 +690,234 @@ Z_Malloc
         *base->user = result;
     }
 
-    // next allocation will start looking here
-    mainzone->rover = base->next;        
-        
     base->id = ZONEID;
+
+    if (tag >= PU_PURGELEVEL)
+        Z_LinkLRU (mainzone, base);
+
+    // telemetry
+    base->site = Z_SiteNumber (file, line);
+
+    Z_AddStats (&tagstats[tag], base->size);
+    Z_AddStats (&sites[base->site].stats, base->size);
+
+    if (firsttic < 0)
+        firsttic = stattic = gametic;
+
+    if (gametic != stattic)
+    {
+        if (ticallocs > peakticallocs)
+            peakticallocs = ticallocs;
+
+        ticallocs = 0;
+        stattic = gametic;
+    }
+
+    ticallocs++;
+    totalallocs++;
     
     return result;
 }
 
 
 
+//
+// Z_LevelMalloc
+// Allocates level lifetime memory from the level arena.
+// It can not be freed on its own, only with Z_LevelReset.
+//
+void* Z_LevelMalloc (int size)
+{
+    arenachunk_t*      chunk;
+    int                chunksize;
+    void*              result;
+
+    size = (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
+
+    chunk = levelarena;
+
+    if (chunk == NULL || chunk->used + size > chunk->size)
+    {
+        chunksize = size > ARENA_CHUNKSIZE ? size : ARENA_CHUNKSIZE;
+
+        chunk = Z_Malloc (sizeof(arenachunk_t) + chunksize, PU_STATIC, NULL);
+        chunk->size = chunksize;
+        chunk->used = 0;
+
+        if (levelarena && size > ARENA_CHUNKSIZE / 4)
+        {
+            // a big block gets a chunk of its own, behind the
+            // current one, which keeps serving the small blocks
+            chunk->next = levelarena->next;
+            levelarena->next = chunk;
+        }
+        else
+        {
+            chunk->next = levelarena;
+            levelarena = chunk;
+        }
+    }
+
+    result = (byte *) chunk + sizeof(arenachunk_t) + chunk->used;
+
+    chunk->used += size;
+    arenaused += size;
+
+    return result;
+}
+
+
+//
+// Z_PoolAlloc
+// Returns an object from the pool, adding a slab of slots
+// from the level arena if none are free.
+//
+void* Z_PoolAlloc (mempool_t* pool)
+{
+    poolslot_t*        slot;
+    byte*              slab;
+    int                slotsize;
+    int                i;
+
+    if (pool->freelist == NULL)
+    {
+        slotsize = sizeof(poolslot_t)
+                 + ((pool->size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1));
+
+        slab = Z_LevelMalloc (slotsize * POOL_SLABSLOTS);
+
+        // thread the new slots onto the free list, keeping
+        // them in address order
+        for (i = POOL_SLABSLOTS - 1 ; i >= 0 ; i--)
+        {
+            slot = (poolslot_t *) (slab + i * slotsize);
+            slot->pool = pool;
+            slot->id = 0;
+            *(void **) (slot + 1) = pool->freelist;
+            pool->freelist = slot + 1;
+        }
+
+        if (pool->numslots == 0)
+        {
+            pool->next = pools;
+            pools = pool;
+        }
+
+        pool->numslots += POOL_SLABSLOTS;
+    }
+
+    slot = (poolslot_t *) pool->freelist - 1;
+    pool->freelist = *(void **) pool->freelist;
+
+    slot->id = POOLID;
+    pool->numlive++;
+
+    return slot + 1;
+}
+
+
+//
+// Z_PoolFree
+// Returns an object to the pool it came from.
+//
+void Z_PoolFree (void* ptr)
+{
+    poolslot_t*        slot;
+    mempool_t*         pool;
+
+    slot = (poolslot_t *) ptr - 1;
+
+    if (slot->id != POOLID)
+        I_Error ("Z_PoolFree: freed a pointer without POOLID");
+
+    pool = slot->pool;
+
+    slot->id = 0;
+    *(void **) ptr = pool->freelist;
+    pool->freelist = ptr;
+    pool->numlive--;
+}
+
+
+//
+// Z_LevelReset
+// Throws away everything in the level arena.
+// If the last level needed more than one chunk, the chunks are
+// replaced by a single one big enough for a level like it.
+//
+void Z_LevelReset (void)
+{
+    arenachunk_t*      chunk;
+    arenachunk_t*      next;
+    int                lastused;
+
+    lastused = arenaused;
+    arenaused = 0;
+
+    // the pool slabs go with the arena
+    while (pools)
+    {
+        pools->freelist = NULL;
+        pools->numlive = 0;
+        pools->numslots = 0;
+        pools = pools->next;
+    }
+
+    if (levelarena && levelarena->next == NULL)
+    {
+        levelarena->used = 0;
+        return;
+    }
+
+    for (chunk = levelarena ; chunk ; chunk = next)
+    {
+        next = chunk->next;
+        Z_Free (chunk);
+    }
+
+    levelarena = NULL;
+
+    if (lastused > 0)
+    {
+        chunk = Z_Malloc (sizeof(arenachunk_t) + lastused, PU_STATIC, NULL);
+        chunk->next = NULL;
+        chunk->size = lastused;
+        chunk->used = 0;
+
+        levelarena = chunk;
+    }
+}
+
+
+//
+// Z_LevelArenaUsed
+// Bytes handed out from the level arena since the last reset.
+//
+int Z_LevelArenaUsed (void)
+{
+    return arenaused;
+}
+
+
+//
+// Z_LevelArenaSize
+// Bytes the level arena holds in the zone.
+//
+int Z_LevelArenaSize (void)
+{
+    arenachunk_t*      chunk;
+    int                size;
+
+    size = 0;
+
+    for (chunk = levelarena ; chunk ; chunk = chunk->next)
+        size += sizeof(arenachunk_t) + chunk->size;
+
+    return size;
+}
+
+
+
 //
 // Z_FreeTags
 //
@@ -335,6 +963,9 @@ Z_DumpHeap
     
     C_Printf ("tag range: %i to %i\n",
             lowtag, hightag);
+
+    C_Printf ("level arena: %i of %i bytes used\n",
+            Z_LevelArenaUsed(), Z_LevelArenaSize());
         
     for (block = mainzone->blocklist.next ; ; block = block->next)
     {
@@ -368,6 +999,9 @@ void Z_FileDumpHeap (FILE* f)
     memblock_t*        block;
         
     fprintf (f,"zone size: %i  location: %p\n",mainzone->size,mainzone);
+
+    fprintf (f,"level arena: %i of %i bytes used\n",
+             Z_LevelArenaUsed(), Z_LevelArenaSize());
         
     for (block = mainzone->blocklist.next ; ; block = block->next)
     {
@@ -393,15 +1027,154 @@ void Z_FileDumpHeap (FILE* f)
 
 
 
+//
+// Z_LargestFree
+// The biggest free block lives on the highest non-empty free list.
+//
+static int Z_LargestFree (void)
+{
+    int                fl, sl;
+    int                largest;
+    memblock_t*        block;
+
+    if (!mainzone->fl_bitmap)
+        return 0;
+
+    fl = 31 - __builtin_clz(mainzone->fl_bitmap);
+    sl = 31 - __builtin_clz(mainzone->sl_bitmap[fl]);
+
+    largest = 0;
+
+    for (block = mainzone->freelists[fl][sl] ;
+         block ;
+         block = FREELINKS(block)->next)
+    {
+        if (block->size > largest)
+            largest = block->size;
+    }
+
+    return largest;
+}
+
+
+//
+// CompareSites
+// Sorts call sites by peak bytes, biggest first.
+//
+static int CompareSites (const void* a, const void* b)
+{
+    const zonesite_t*  sa = *(const zonesite_t **) a;
+    const zonesite_t*  sb = *(const zonesite_t **) b;
+
+    return sb->stats.peak - sa->stats.peak;
+}
+
+
+//
+// Z_WriteStats
+// Prints the telemetry to f, or to the console if f is NULL,
+// listing at most maxsites call sites.
+//
+static void Z_WriteStats (FILE* f, int maxsites)
+{
+    static zonesite_t* sorted[MAXSITES];
+    zonestats_t*       stats;
+    int                largest;
+    int                tics;
+    int                i;
+
+    largest = Z_LargestFree ();
+    tics = firsttic < 0 ? 1 : gametic - firsttic + 1;
+
+    if (ticallocs > peakticallocs)
+        peakticallocs = ticallocs;
+
+    C_FPrintf (f, "zone size: %i  free: %i  largest free: %i\n",
+               mainzone->size, freebytes, largest);
+
+    C_FPrintf (f, "fragmentation: %.3f\n",
+               freebytes ? 1.0 - (double) largest / freebytes : 0.0);
+
+    C_FPrintf (f, "allocations: %i  per tic: %.1f  peak per tic: %i\n",
+               totalallocs, (double) totalallocs / tics, peakticallocs);
+
+    C_FPrintf (f, "purged: %i blocks  %i bytes\n",
+               purgedblocks, purgedbytes);
+
+    C_FPrintf (f, "%-24s %9s %9s %8s %8s\n",
+               "tag", "live", "peak", "allocs", "frees");
+
+    for (i = 1 ; i < PU_NUM_TAGS ; i++)
+    {
+        stats = &tagstats[i];
+
+        if (i == PU_FREE)
+            continue;
+
+        C_FPrintf (f, "%-24s %9i %9i %8i %8i\n", tagnames[i],
+                   stats->live, stats->peak, stats->allocs, stats->frees);
+    }
+
+    for (i = 0 ; i < numsites ; i++)
+        sorted[i] = &sites[i];
+
+    qsort (sorted, numsites, sizeof(*sorted), CompareSites);
+
+    C_FPrintf (f, "%-24s %9s %9s %8s %8s\n",
+               "call site", "live", "peak", "allocs", "frees");
+
+    for (i = 0 ; i < numsites && i < maxsites ; i++)
+    {
+        stats = &sorted[i]->stats;
+
+        if (!stats->allocs)
+            continue;
+
+        C_FPrintf (f, "%-18.18s:%-5i %9i %9i %8i %8i\n",
+                   sorted[i]->file, sorted[i]->line,
+                   stats->live, stats->peak, stats->allocs, stats->frees);
+    }
+}
+
+
+//
+// Z_DumpStats
+// Prints the zone telemetry, and the busiest call sites,
+// to the console.
+//
+void Z_DumpStats (void)
+{
+    Z_WriteStats (NULL, 16);
+}
+
+
+//
+// Z_FileDumpStats
+//
+void Z_FileDumpStats (FILE* f)
+{
+    Z_WriteStats (f, MAXSITES);
+}
+
+
 //
 // Z_CheckHeap
 //
 void Z_CheckHeap (void)
 {
     memblock_t*        block;
+    memblock_t*        prev;
+    int                numfree;
+    int                fl, sl;
+    int                bfl, bsl;
         
+    numfree = 0;
+
     for (block = mainzone->blocklist.next ; ; block = block->next)
     {
+        if (block->tag == PU_FREE)
+            numfree++;
+
         if (block->next == &mainzone->blocklist)
         {
             // all blocks have been hit
@@ -417,6 +1190,53 @@ void Z_CheckHeap (void)
         if (block->tag == PU_FREE && block->next->tag == PU_FREE)
             I_Error ("Z_CheckHeap: two consecutive free blocks\n");
     }
+
+    // every free block must be on the free list for its size,
+    // and the bitmaps must match the lists
+    for (fl = 0 ; fl < FL_INDEX_COUNT ; fl++)
+    {
+        if (!(mainzone->fl_bitmap & (1U << fl)) != !mainzone->sl_bitmap[fl])
+            I_Error ("Z_CheckHeap: free list bitmaps disagree\n");
+
+        for (sl = 0 ; sl < SL_INDEX_COUNT ; sl++)
+        {
+            block = mainzone->freelists[fl][sl];
+
+            if (!(mainzone->sl_bitmap[fl] & (1U << sl)) != !block)
+                I_Error ("Z_CheckHeap: free list bitmap is wrong\n");
+
+            for (prev = NULL ; block ; prev = block, block = FREELINKS(block)->next)
+            {
+                if (block->tag != PU_FREE)
+                    I_Error ("Z_CheckHeap: used block on a free list\n");
+
+                if (FREELINKS(block)->prev != prev)
+                    I_Error ("Z_CheckHeap: free list doesn't have proper back link\n");
+
+                Z_SizeClass (block->size, &bfl, &bsl);
+
+                if (bfl != fl || bsl != sl)
+                    I_Error ("Z_CheckHeap: free block on the wrong free list\n");
+
+                numfree--;
+            }
+        }
+    }
+
+    if (numfree != 0)
+        I_Error ("Z_CheckHeap: free block missing from the free lists\n");
+
+    // every block on the LRU list must be purgable
+    for (block = mainzone->lrulist.lrunext ;
+         block != &mainzone->lrulist ;
+         block = block->lrunext)
+    {
+        if (block->tag < PU_PURGELEVEL)
+            I_Error ("Z_CheckHeap: unpurgable block on the LRU list\n");
+
+        if (block->lrunext->lruprev != block)
+            I_Error ("Z_CheckHeap: LRU list doesn't have proper back link\n");
+    }
 }
 
 
@@ -439,9 +1259,38 @@ void Z_ChangeTag2(void *ptr, int tag, char *file, int line)
         I_Error("%s:%i: Z_ChangeTag: an owner is required "
                 "for purgable blocks", file, line);
 
+    tagstats[block->tag].live -= block->size;
+    tagstats[tag].live += block->size;
+
+    if (tagstats[tag].live > tagstats[tag].peak)
+        tagstats[tag].peak = tagstats[tag].live;
+
+    if (block->tag >= PU_PURGELEVEL && tag < PU_PURGELEVEL)
+        Z_UnlinkLRU (block);
+    else if (block->tag < PU_PURGELEVEL && tag >= PU_PURGELEVEL)
+        Z_LinkLRU (mainzone, block);
+
     block->tag = tag;
 }
 
+//
+// Z_Touch
+// Marks a block as just used, so it is purged after the
+// blocks that have not been used for longer.
+//
+void Z_Touch (void *ptr)
+{
+    memblock_t*        block;
+
+    block = (memblock_t *) ((byte *)ptr - sizeof(memblock_t));
+
+    if (block->tag >= PU_PURGELEVEL)
+    {
+        Z_UnlinkLRU (block);
+        Z_LinkLRU (mainzone, block);
+    }
+}
+
 void Z_ChangeUser(void *ptr, void **user)
 {
     memblock_t*        block;
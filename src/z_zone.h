@@ -34,6 +34,9 @@
 #define Z_ChangeTag(p,t)                                       \
     Z_ChangeTag2((p), (t), __FILE__, __LINE__)
 
+#define Z_Malloc(s,t,u)                                        \
+    Z_Malloc2((s), (t), (u), __FILE__, __LINE__)
+
 
 //
 // ZONE MEMORY
@@ -59,16 +62,40 @@ enum
 };
         
 
+//
+// Pool of fixed size objects, see Z_PoolAlloc.
+// Define one per type as { sizeof(type) }.
+//
+typedef struct mempool_s
+{
+    int                 size;           // bytes per object
+    void*               freelist;
+    int                 numlive;
+    int                 numslots;
+    struct mempool_s*   next;           // next pool with slots
+} mempool_t;
+
+
 void         *(Z_Realloc)(void *ptr, size_t n, int tag, void **user);
 void         Z_Init (void);
-void         *Z_Malloc (int size, int tag, void *ptr);
+void         *Z_Malloc2 (int size, int tag, void *ptr, char *file, int line);
 void         Z_Free (void *ptr);
 void         Z_FreeTags (int lowtag, int hightag);
 void         Z_DumpHeap (int lowtag, int hightag);
 void         Z_FileDumpHeap (FILE *f);
+void         Z_DumpStats (void);
+void         Z_FileDumpStats (FILE *f);
 void         Z_CheckHeap (void);
 void         Z_ChangeTag2 (void *ptr, int tag, char *file, int line);
 void         Z_ChangeUser(void *ptr, void **user);
+void         Z_Touch (void *ptr);
+void         Z_SetPurgeCallback (void (*callback) (void));
+void         *Z_LevelMalloc (int size);
+void         Z_LevelReset (void);
+int          Z_LevelArenaUsed (void);
+int          Z_LevelArenaSize (void);
+void         *Z_PoolAlloc (mempool_t *pool);
+void         Z_PoolFree (void *ptr);
 
 int          Z_FreeMemory (void);
 